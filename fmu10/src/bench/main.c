@@ -0,0 +1,212 @@
+/* -------------------------------------------------------------------------
+ * main.c
+ * Implements parser_bench, which measures the FMI 1.0 model description
+ * parser of shared/xml_parser.c on synthetic model descriptions.
+ * Command syntax: parser_bench [-d <dir>] [-o <file>] [-l <lookups>] <variables>
+ *   -d directory of the generated files, defaults to the current directory
+ *   -o append the results to the given csv file, defaults to parser_bench.csv
+ *   -l number of variable lookups, defaults to 1000000
+ * The model description bench10_<variables>.xml is generated unless it
+ * exists. It has units, types, states and their derivatives, outputs with
+ * direct dependencies, parameters, integers, booleans, enumerations and
+ * aliases. One line is appended to the csv file, with a header if the file
+ * is new: parse time, peak resident set size of the process and the rate
+ * of lookups of variables by name and by value reference, in the columns
+ * written by the parser_bench of fmu20. Run it once per size, the peak
+ * resident set size is that of the whole process.
+ * Copyright QTronic GmbH. All rights reserved.
+ * -------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef _MSC_VER
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <time.h>
+#include <sys/resource.h>
+#endif
+#include "xml_parser.h"
+
+// number of distinct names looked up, cycled through for all lookups
+#define NAMES 65536
+
+static double now() {
+#ifdef _MSC_VER
+    LARGE_INTEGER count, frequency;
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&frequency);
+    return (double)count.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+#endif
+}
+
+// peak resident set size of the process in KB
+static long peakRss() {
+#ifdef _MSC_VER
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return (long)(counters.PeakWorkingSetSize / 1024);
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+// Variable i follows the pattern i % 8: a state, its derivative, an output
+// depending on the state, a parameter, an integer, a boolean, an enumeration,
+// and an alias of the output. Value reference i, except for the alias.
+static int generate(const char *path, int n) {
+    int i;
+    FILE *file = fopen(path, "w");
+    if (!file) return 0;
+    fprintf(file, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<fmiModelDescription fmiVersion=\"1.0\" modelName=\"bench\" modelIdentifier=\"bench\""
+        " guid=\"{bench10-%d}\" numberOfContinuousStates=\"%d\" numberOfEventIndicators=\"0\">\n"
+        "<UnitDefinitions>\n"
+        "  <BaseUnit unit=\"rad\"><DisplayUnitDefinition displayUnit=\"deg\" gain=\"57.2957795130823\"/></BaseUnit>\n"
+        "  <BaseUnit unit=\"m/s\"><DisplayUnitDefinition displayUnit=\"km/h\" gain=\"3.6\"/></BaseUnit>\n"
+        "</UnitDefinitions>\n"
+        "<TypeDefinitions>\n"
+        "  <Type name=\"Angle\"><RealType quantity=\"Angle\" unit=\"rad\" displayUnit=\"deg\"/></Type>\n"
+        "  <Type name=\"Velocity\"><RealType quantity=\"Velocity\" unit=\"m/s\" min=\"0\"/></Type>\n"
+        "  <Type name=\"Mode\"><EnumerationType><Item name=\"off\"/><Item name=\"on\"/></EnumerationType></Type>\n"
+        "</TypeDefinitions>\n"
+        "<DefaultExperiment startTime=\"0\" stopTime=\"1\"/>\n"
+        "<ModelVariables>\n", n, (n + 7) / 8);
+    for (i = 0; i < n; i++) {
+        switch (i % 8) {
+            case 0: fprintf(file, "  <ScalarVariable name=\"v%d\" valueReference=\"%d\" description=\"state %d\">"
+                "<Real declaredType=\"Angle\" start=\"%d.5\" fixed=\"true\"/></ScalarVariable>\n", i, i, i, i);
+                break;
+            case 1: fprintf(file, "  <ScalarVariable name=\"v%d\" valueReference=\"%d\" description=\"der(v%d)\">"
+                "<Real/></ScalarVariable>\n", i, i, i - 1);
+                break;
+            case 2: fprintf(file, "  <ScalarVariable name=\"v%d\" valueReference=\"%d\" causality=\"output\">"
+                "<Real declaredType=\"Velocity\"/><DirectDependency><Name>v%d</Name></DirectDependency>"
+                "</ScalarVariable>\n", i, i, i - 2);
+                break;
+            case 3: fprintf(file, "  <ScalarVariable name=\"v%d\" valueReference=\"%d\" variability=\"parameter\">"
+                "<Real start=\"%d\" nominal=\"10\"/></ScalarVariable>\n", i, i, i);
+                break;
+            case 4: fprintf(file, "  <ScalarVariable name=\"v%d\" valueReference=\"%d\" variability=\"discrete\">"
+                "<Integer start=\"%d\" min=\"0\"/></ScalarVariable>\n", i, i, i);
+                break;
+            case 5: fprintf(file, "  <ScalarVariable name=\"v%d\" valueReference=\"%d\" variability=\"discrete\">"
+                "<Boolean start=\"true\"/></ScalarVariable>\n", i, i);
+                break;
+            case 6: fprintf(file, "  <ScalarVariable name=\"v%d\" valueReference=\"%d\" variability=\"discrete\">"
+                "<Enumeration declaredType=\"Mode\" start=\"1\"/></ScalarVariable>\n", i, i);
+                break;
+            case 7: fprintf(file, "  <ScalarVariable name=\"v%d\" valueReference=\"%d\" alias=\"alias\">"
+                "<Real declaredType=\"Velocity\"/></ScalarVariable>\n", i, i - 5);
+                break;
+        }
+    }
+    fprintf(file, "</ModelVariables>\n</fmiModelDescription>\n");
+    return fclose(file) == 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *dir = ".";
+    const char *output = "parser_bench.csv";
+    long lookups = 1000000;
+    int n = 0;
+    int i;
+    char xmlPath[1024];
+    char **names;
+    long bytes;
+    long found = 0;
+    double start, parseTime, lookupTime;
+    ModelDescription *md;
+    FILE *file;
+
+    for (i = 1; i < argc - 1; i += 2) {
+        if (!strcmp(argv[i], "-d")) dir = argv[i + 1];
+        else if (!strcmp(argv[i], "-o")) output = argv[i + 1];
+        else if (!strcmp(argv[i], "-l")) lookups = atol(argv[i + 1]);
+        else break;
+    }
+    if (i == argc - 1) n = atoi(argv[i]);
+    if (n < 8 || lookups < 1) {
+        printf("command syntax: %s [-d <dir>] [-o <file>] [-l <lookups>] <variables>\n", argv[0]);
+        printf("   -d <dir> ....... directory of the generated model descriptions, optional\n");
+        printf("   -o <file> ...... csv file the results are appended to, defaults to parser_bench.csv\n");
+        printf("   -l <lookups> ... number of variable lookups, defaults to 1000000\n");
+        printf("   <variables> .... number of variables of the model description, at least 8\n");
+        return EXIT_FAILURE;
+    }
+
+    sprintf(xmlPath, "%.1000s/bench10_%d.xml", dir, n);
+    file = fopen(xmlPath, "r");
+    if (file) {
+        fclose(file);
+    } else if (!generate(xmlPath, n)) {
+        printf("error: Could not write %s\n", xmlPath);
+        return EXIT_FAILURE;
+    }
+    file = fopen(xmlPath, "r");
+    fseek(file, 0, SEEK_END);
+    bytes = ftell(file);
+    fclose(file);
+
+    start = now();
+    md = parse(xmlPath);
+    parseTime = now() - start;
+    if (!md) {
+        printf("error: Could not parse %s\n", xmlPath);
+        return EXIT_FAILURE;
+    }
+
+    // names of random variables, and every second lookup by value reference
+    names = (char **)malloc(NAMES * sizeof(char *));
+    srand(1);
+    for (i = 0; i < NAMES; i++) {
+        names[i] = (char *)malloc(16);
+        sprintf(names[i], "v%d", rand() % n);
+    }
+    start = now();
+    for (i = 0; i < lookups; i++) {
+        const char *name = names[i % NAMES];
+        if (i % 2 == 0) {
+            if (getVariableByName(md, name)) found++;
+        } else {
+            // the value reference of a Real: a state, derivative, output or parameter
+            int k = atoi(name + 1) & ~7;
+            if (getVariable(md, (fmiValueReference)(k + (i >> 1) % 4), elm_Real)) found++;
+        }
+    }
+    lookupTime = now() - start;
+    for (i = 0; i < NAMES; i++) free(names[i]);
+    free(names);
+    freeElement(md);
+
+    file = fopen(output, "a");
+    if (!file) {
+        printf("error: Could not write %s\n", output);
+        return EXIT_FAILURE;
+    }
+    fseek(file, 0, SEEK_END);
+    if (ftell(file) == 0) {
+        fprintf(file, "parser,reader,variables,bytes,parse_seconds,first_access_seconds,peak_rss_kb,"
+            "bytes_per_variable,lookups,found,lookups_per_second\n");
+    }
+    // the variables are parsed with the model description, nothing to do on first access.
+    // The elements are allocated one by one, bytes_per_variable is left empty.
+    fprintf(file, "fmu10,expat,%d,%ld,%.6f,0,%ld,,%ld,%ld,%.0f\n", n, bytes, parseTime, peakRss(), lookups, found,
+        lookups / (lookupTime > 0 ? lookupTime : 1e-9));
+    fclose(file);
+    printf("%s: %d variables parsed in %.3f s, %.0f lookups per second\n", xmlPath, n, parseTime,
+        lookups / (lookupTime > 0 ? lookupTime : 1e-9));
+    return EXIT_SUCCESS;
+}
@@ -294,6 +294,28 @@ static void printModelDescription(ModelDescription* md){
 #endif // FMI_COSIMULATION  
 }
 
+// base type of the type char used in log messages, one of ribs
+static Elm elmType(char type) {
+    switch (type) {
+        case 'r': return elm_Real;
+        case 'i': return elm_Integer;
+        case 'b': return elm_Boolean;
+        case 's': return elm_String;
+        default:  return elm_BAD_DEFINED;
+    }
+}
+
+// name of the variable of the given type, one of ribs, and value reference.
+// Aliases resolve to the variable with alias noAlias, as for the outputs.
+// Returns NULL if not found or vr = fmiUndefinedValueReference.
+static const char* getVrName(char type, fmiValueReference vr) {
+    ScalarVariable* sv;
+    Elm elm = elmType(type);
+    if (elm == elm_BAD_DEFINED || !fmu.modelDescription) return NULL;
+    sv = getVariable(fmu.modelDescription, vr, elm);
+    return sv ? getName(sv) : NULL;
+}
+
 void loadFMU(const char* fmuFileName) {
     char* fmuPath;
     char* tmpPath;
@@ -449,36 +471,14 @@ static const char* fmiStatusToString(fmiStatus status){
     }
 }
 
-// search a fmu for the given variable
-// return NULL if not found or vr = fmiUndefinedValueReference
-static ScalarVariable* getSV(FMU* fmu, char type, fmiValueReference vr) {
-    int i;
-    Elm tp;
-    ScalarVariable** vars = fmu->modelDescription->modelVariables;
-    if (vr==fmiUndefinedValueReference) return NULL;
-    switch (type) {
-        case 'r': tp = elm_Real;    break;
-        case 'i': tp = elm_Integer; break;
-        case 'b': tp = elm_Boolean; break;
-        case 's': tp = elm_String;  break;
-        default:  tp = elm_BAD_DEFINED; break;
-    }
-    for (i=0; vars[i]; i++) {
-        ScalarVariable* sv = vars[i];
-        if (vr==getValueReference(sv) && tp==sv->typeSpec->type)
-            return sv;
-    }
-    return NULL;
-}
-
 // replace e.g. #r1365# by variable name and ## by # in message
 // copies the result to buffer
-static void replaceRefsInMessage(const char* msg, char* buffer, int nBuffer, FMU* fmu){
+static void replaceRefsInMessage(const char* msg, char* buffer, int nBuffer){
     int i=0; // position in msg
     int k=0; // position in buffer
     int n;
     char c = msg[i];
-    while (c!='\0' && k < nBuffer) {
+    while (c!='\0' && k < nBuffer-1) {
         if (c!='#') {
             buffer[k++]=c;
             i++;
@@ -504,10 +504,9 @@ static void replaceRefsInMessage(const char* msg, char* buffer, int nBuffer, FMU
                 int nvr = sscanf(msg+i+2, "%u", &vr);
                 if (nvr==1) {
                     // vr of type detected, e.g. #r12#
-                    ScalarVariable* sv = getSV(fmu, type, vr);
-                    const char* name = sv ? getName(sv) : "?";
-                    sprintf(buffer+k, "%s", name);
-                    k += strlen(name);
+                    const char* name = getVrName(type, vr);
+                    if (!name) name = "?";
+                    while (*name && k < nBuffer-1) buffer[k++] = *name++;
                     i += (n+1);
                     c = msg[i]; 
                 }
@@ -524,21 +523,27 @@ static void replaceRefsInMessage(const char* msg, char* buffer, int nBuffer, FMU
 }
 
 #define MAX_MSG_SIZE 1000
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
 void fmuLogger(fmiComponent c, fmiString instanceName, fmiStatus status,
                fmiString category, fmiString message, ...) {
-    char msg[MAX_MSG_SIZE];
-    char* copy;
+    // scratch buffers per thread, as the FMU may log from several threads
+    static THREAD_LOCAL char formatted[MAX_MSG_SIZE];
+    static THREAD_LOCAL char msg[MAX_MSG_SIZE];
     va_list argp;
 
     // replace C format strings
     va_start(argp, message);
-    vsprintf(msg, message, argp);
+    vsnprintf(formatted, MAX_MSG_SIZE, message, argp);
     va_end(argp);
 
     // replace e.g. ## and #r12#  
-    copy = strdup(msg);
-    replaceRefsInMessage(copy, msg, MAX_MSG_SIZE, &fmu);
-    free(copy);
+    replaceRefsInMessage(formatted, msg, MAX_MSG_SIZE);
     
     // print the final message
     if (!instanceName) instanceName = "?";
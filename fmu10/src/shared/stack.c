@@ -13,77 +13,133 @@
 #include <stdlib.h>
 #include "stack.h"
 
-Stack* stackNew(int initialSize, int inc){
+// Returns NULL to indicate failure
+Stack* stackNew(int initialSize){
     Stack* s = (Stack*)malloc(sizeof(Stack));
-    s->stack = NULL;
-    s->stackSize = 0;
-    s->stackPos = -1;
-    s->initialSize = initialSize;
-    s->inc = inc;
+    if (!s) return NULL;
+    s->framesSize = 4;
+    s->frames = (StackFrame*)malloc(s->framesSize * sizeof(StackFrame));
+    if (!s->frames) {
+        free(s);
+        return NULL;
+    }
+    s->frames[0].stack = NULL;
+    s->frames[0].stackSize = 0;
+    s->frames[0].stackPos = -1;
+    s->nFrames = 1;
+    s->initialSize = initialSize < 2 ? 2 : initialSize;
     return s;
 }
 
+// Returns the top frame that is not empty, or the bottom frame
+static StackFrame* topElementFrame(Stack* s) {
+    int i = s->nFrames - 1;
+    while (i > 0 && s->frames[i].stackPos == -1) i--;
+    return &s->frames[i];
+}
+
 int stackIsEmpty(Stack* s) {
-    return s->stackPos == -1;
+    return topElementFrame(s)->stackPos == -1;
 }
 
-// add an element to stack and grow stack if required
+// add an element to the top frame and grow its buffer if required.
+// One slot is kept free for the terminating NULL of stackPopFrame.
 // returns 1 to indicate success and 0 for error
 int stackPush(Stack* s, void* e) {
-    s->stackPos++;
-    if (s->stackPos==s->stackSize){
-        s->stackSize += (s->stack ? s->inc: s->initialSize);
-        s->stack = (void**) realloc(s->stack, s->stackSize * sizeof(void*));
-        if (!s->stack) return 0; // error;
+    StackFrame* f = &s->frames[s->nFrames - 1];
+    if (f->stackPos + 2 >= f->stackSize){
+        int size = f->stack ? 2 * f->stackSize : s->initialSize;
+        void** stack = (void**) realloc(f->stack, size * sizeof(void*));
+        if (!stack) return 0; // error;
+        f->stack = stack;
+        f->stackSize = size;
     }
-    s->stack[s->stackPos] = e;
+    f->stack[++f->stackPos] = e;
     return 1; // success
 }
 
 // return top element (possibly NULL), if stack not empty
 // runtime error if stack is empty
 void* stackPeek(Stack* s){
-    assert(!stackIsEmpty(s));
-    return s->stack[s->stackPos];
+    StackFrame* f = topElementFrame(s);
+    assert(f->stackPos != -1);
+    return f->stack[f->stackPos];
 }
 
-// remove top element (possibly NULL) from stack and return it
+// remove top element (possibly NULL) from stack and return it.
+// Empty frames above the element are removed.
 // runtime error if stack is empty
 void* stackPop(Stack* s){
-    assert(!stackIsEmpty(s));
-    return s->stack[s->stackPos--];
+    StackFrame* f = topElementFrame(s);
+    assert(f->stackPos != -1);
+    while (&s->frames[s->nFrames - 1] != f) {
+        free(s->frames[--s->nFrames].stack);
+    }
+    return f->stack[f->stackPos--];
 }
 
-// return the last n elements as null terminated array,
-// or NULL if memory allocation fails
-void** stackLastPopedAsArray0(Stack* s, int n){
-    int i;
-    void** array = (void**)malloc((n + 1)*sizeof(void*));
-    if (! array) return NULL; // failure
-    for (i=0; i<n; i++) {
-        array[i] = s->stack[i+ s->stackPos + 1];
+// start a new, empty frame on top of the stack
+// returns 1 to indicate success and 0 for error
+int stackPushFrame(Stack* s) {
+    StackFrame* f;
+    if (s->nFrames == s->framesSize) {
+        StackFrame* frames = (StackFrame*)realloc(s->frames, 2 * s->framesSize * sizeof(StackFrame));
+        if (!frames) return 0; // error
+        s->frames = frames;
+        s->framesSize *= 2;
     }
-    array[n]=NULL; // terminating NULL
+    f = &s->frames[s->nFrames++];
+    f->stack = NULL;
+    f->stackSize = 0;
+    f->stackPos = -1;
+    return 1; // success
+}
+
+// remove the top frame and return its elements as null terminated array,
+// or NULL if memory allocation fails. The array is the buffer of the frame,
+// the elements are not copied. The caller must free the array.
+void** stackPopFrame(Stack* s, int *size) {
+    StackFrame* f = &s->frames[s->nFrames - 1];
+    void** array;
+    assert(s->nFrames > 1);
+    *size = f->stackPos + 1;
+    if (!f->stack) {
+        array = (void**)malloc(sizeof(void*));
+        if (!array) return NULL; // failure
+    } else {
+        // shrink to fit, if realloc fails the buffer is kept as it is
+        array = (void**)realloc(f->stack, (*size + 1) * sizeof(void*));
+        if (!array) array = f->stack;
+    }
+    array[*size] = NULL; // terminating NULL
+    s->nFrames--;
     return array;
 }
 
 // return stack as possibly empty array, or NULL if memory allocation fails
-// On successful return, the stack is empty.
+// On successful return, the stack is empty and has a single frame.
 void** stackPopAllAsArray(Stack* s, int *size) {
-    int i;
-    void** array = (void**)malloc((s->stackPos + 1)*sizeof(void*));
+    int i, j;
+    void** array;
+    *size = 0;
+    for (i=0; i<s->nFrames; i++)
+        *size += s->frames[i].stackPos + 1;
+    array = (void**)malloc((*size > 0 ? *size : 1) * sizeof(void*));
     if (! array) return NULL; // failure
-    *size = s->stackPos + 1;
-    for (i=0; i<*size; i++)
-        array[i] = s->stack[i];
-    s->stackPos = -1;
+    *size = 0;
+    for (i=0; i<s->nFrames; i++)
+        for (j=0; j<=s->frames[i].stackPos; j++)
+            array[(*size)++] = s->frames[i].stack[j];
+    while (s->nFrames > 1) free(s->frames[--s->nFrames].stack);
+    s->frames[0].stackPos = -1;
     return array;
 }
 
 // release the given stack
 void stackFree(Stack* s){
-    if (s->stack) free(s->stack);
+    int i;
+    for (i=0; i<s->nFrames; i++)
+        if (s->frames[i].stack) free(s->frames[i].stack);
+    free(s->frames);
     free(s);
 }
-
-
@@ -5,6 +5,10 @@
 /* -------------------------------------------------------------------------
  * stack.c
  * A stack of pointers.
+ * The elements are kept in frames: stackPushFrame starts a new frame on
+ * top of the stack, and stackPopFrame removes it and hands its buffer to
+ * the caller as array, without copying the elements. Push, peek and pop
+ * see the frames as one stack. The buffer of a frame grows geometrically.
  * Author: Jakob Mauss, January 2010.
  * -------------------------------------------------------------------------*/
 
@@ -17,21 +21,27 @@ extern "C" {
 typedef struct {
     void** stack;
     int stackSize;    // allocated size of stack
-    int stackPos;     // array index of top element, -1 if stack is empty.
-    int initialSize;  // how many element to allocate initially
-    int inc;          // how many elements to allocate when stack gets full
+    int stackPos;     // array index of top element, -1 if frame is empty.
+} StackFrame;
+
+typedef struct {
+    StackFrame* frames;
+    int nFrames;      // number of frames, at least 1
+    int framesSize;   // allocated size of frames
+    int initialSize;  // how many element to allocate initially for a frame
 } Stack;
 
-Stack* stackNew(int initialSize, int inc);
+Stack* stackNew(int initialSize);
 int stackIsEmpty(Stack* s);
 int stackPush(Stack* s, void* e);
 void* stackPeek(Stack* s);
 void* stackPop(Stack* s);
+int stackPushFrame(Stack* s);
+void** stackPopFrame(Stack* s, int *size);
 void** stackPopAllAsArray(Stack* s, int *size);
-void** stackLastPopedAsArray0(Stack* s, int n);
 void stackFree(Stack* s);
 
 #ifdef __cplusplus
 } // closing brace for extern "C"
 #endif
-#endif // STACK_H
\ No newline at end of file
+#endif // STACK_H
@@ -22,9 +22,19 @@
  * -------------------------------------------------------------------------*/
 
 #include <assert.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef _MSC_VER
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #ifdef STANDALONE_XML_PARSER
 #define logThis(n, ...) printf(__VA_ARGS__);printf("\n")
@@ -59,12 +69,14 @@ const char *enuNames[SIZEOF_ENU] = {
     "input","output", "internal","none","noAlias","alias","negatedAlias"
 };
 
-#define XMLBUFSIZE 1024
-char text[XMLBUFSIZE];       // XML file is parsed in chunks of length XMLBUFZIZE
-XML_Parser parser = NULL;    // non-NULL during parsing
-Stack* stack = NULL;         // the parser stack
-char* data = NULL;           // buffer that holds element content, see handleData
-int skipData=0;              // 1 to ignore element content, 0 when recording content
+// State of one call of parse(), passed to the expat callbacks as user data,
+// so that several files can be parsed concurrently.
+typedef struct {
+    XML_Parser parser;
+    Stack* stack;            // the parser stack
+    char* data;              // buffer that holds element content, see handleData
+    int skipData;            // 1 to ignore element content, 0 when recording content
+} ParserContext;
 
 // -------------------------------------------------------------------------
 // Low-level functions for inspecting the model description 
@@ -114,7 +126,9 @@ char getBoolean(void* element, Att a, ValueStatus* vs){
     return 0;
 }
 
-static Enu checkEnumValue(const char* enu);
+static Enu checkEnumValue(ParserContext* ctx, const char* enu);
+static void freeModelIndex(ModelIndex* index);
+static void initNameTables();
 
 // Retrieve the value of the given built-in enum attribute.
 // If the value is missing, this is marked in the ValueStatus
@@ -135,7 +149,8 @@ Enu getEnumValue(void* element, Att a, ValueStatus* vs) {
             default: return enu_BAD_DEFINED;
         }
     }
-    id = checkEnumValue(value);
+    initNameTables();
+    id = checkEnumValue(NULL, value);
     if (id == enu_BAD_DEFINED) *vs = valueIllegal;
     return id;
 }
@@ -203,9 +218,150 @@ fmiValueReference getValueReference(void* scalarVariable) {
     return vr;
 }
 
+// -------------------------------------------------------------------------
+// Hash indexes of the variables and types, open addressing with linear probing.
+// Each table has at least twice as many slots as entries, so that a lookup
+// always ends at an empty slot.
+
+// slot of a table indexed by name
+typedef struct {
+    unsigned int hash;
+    void* element;           // ScalarVariable or Type, NULL for an empty slot
+} NameSlot;
+
+// slot of the table indexed by base type and value reference
+typedef struct {
+    fmiValueReference vr;
+    Elm baseType;            // elm_Real, elm_Integer, elm_Boolean or elm_String
+    ScalarVariable* sv;      // NULL for an empty slot
+} VrSlot;
+
+struct ModelIndex {
+    NameSlot* variables;     // by name
+    unsigned int variablesMask;   // number of slots - 1, the number of slots is a power of 2
+    VrSlot* vrs;             // by base type and vr
+    unsigned int vrsMask;
+    NameSlot* types;         // by name
+    unsigned int typesMask;
+};
+
+static unsigned int hashString(const char* s) {
+    unsigned int h = 2166136261u;
+    for (; *s; s++) h = (h ^ (unsigned char)*s) * 16777619u;
+    return h;
+}
+
+static unsigned int hashVr(fmiValueReference vr, Elm baseType) {
+    unsigned int h = (unsigned int)vr * 2654435761u ^ (unsigned int)baseType * 40503u;
+    return h ^ (h >> 16);
+}
+
+// the base type of a variable of type t, see sameBaseType
+static Elm baseType(Elm t) {
+    return t==elm_Enumeration ? elm_Integer : t;
+}
+
+// Returns the mask of a table with at least 2*n slots
+static unsigned int tableMask(int n) {
+    unsigned int size = 2;
+    while (size < 2 * (unsigned int)n) size *= 2;
+    return size - 1;
+}
+
+// Returns the slot of name, or the empty slot where it would be inserted
+static NameSlot* findNameSlot(NameSlot* table, unsigned int mask, const char* name, unsigned int hash) {
+    unsigned int h;
+    for (h = hash & mask; table[h].element; h = (h + 1) & mask) {
+        if (table[h].hash == hash && !strcmp(getName(table[h].element), name)) break;
+    }
+    return &table[h];
+}
+
+// Returns the slot of vr and base type, or the empty slot where it would be inserted
+static VrSlot* findVrSlot(VrSlot* table, unsigned int mask, fmiValueReference vr, Elm baseType) {
+    unsigned int h;
+    for (h = hashVr(vr, baseType) & mask; table[h].sv; h = (h + 1) & mask) {
+        if (table[h].vr == vr && table[h].baseType == baseType) break;
+    }
+    return &table[h];
+}
+
+// Index the variables of md by name and by base type and vr, and the types by name.
+// For variables that share the base type and vr, the index of vr holds the variable
+// with alias noAlias, or the first of them if there is none. The first of several
+// variables or types of the same name is indexed. parse() does this for the returned md.
+// Returns 0 to indicate failure, the lookup functions then search the lists.
+int buildModelIndex(ModelDescription* md) {
+    ModelIndex* index;
+    int i;
+    int nVariables = 0;
+    int nTypes = 0;
+    if (md->index) return 1;
+    if (md->modelVariables) while (md->modelVariables[nVariables]) nVariables++;
+    if (md->typeDefinitions) while (md->typeDefinitions[nTypes]) nTypes++;
+    index = (ModelIndex*)calloc(1, sizeof(ModelIndex));
+    if (!index) return 0;
+    index->variablesMask = tableMask(nVariables);
+    index->vrsMask = index->variablesMask;
+    index->typesMask = tableMask(nTypes);
+    index->variables = (NameSlot*)calloc(index->variablesMask + 1, sizeof(NameSlot));
+    index->vrs = (VrSlot*)calloc(index->vrsMask + 1, sizeof(VrSlot));
+    index->types = (NameSlot*)calloc(index->typesMask + 1, sizeof(NameSlot));
+    if (!index->variables || !index->vrs || !index->types) {
+        freeModelIndex(index);
+        return 0;
+    }
+    for (i=0; i<nVariables; i++){
+        ScalarVariable* sv = md->modelVariables[i];
+        const char* name = getName(sv);
+        unsigned int hash = hashString(name);
+        NameSlot* ns = findNameSlot(index->variables, index->variablesMask, name, hash);
+        fmiValueReference vr = getValueReference(sv);
+        if (!ns->element) {
+            ns->hash = hash;
+            ns->element = sv;
+        }
+        if (vr != fmiUndefinedValueReference) {
+            Elm bt = baseType(sv->typeSpec->type);
+            VrSlot* vs = findVrSlot(index->vrs, index->vrsMask, vr, bt);
+            if (!vs->sv) {
+                vs->vr = vr;
+                vs->baseType = bt;
+                vs->sv = sv;
+            } else if (getAlias(vs->sv) != enu_noAlias && getAlias(sv) == enu_noAlias) {
+                vs->sv = sv;
+            }
+        }
+    }
+    for (i=0; i<nTypes; i++){
+        Type* tp = md->typeDefinitions[i];
+        const char* name = getName(tp);
+        unsigned int hash = hashString(name);
+        NameSlot* ns = findNameSlot(index->types, index->typesMask, name, hash);
+        if (!ns->element) {
+            ns->hash = hash;
+            ns->element = tp;
+        }
+    }
+    md->index = index;
+    return 1;
+}
+
+static void freeModelIndex(ModelIndex* index) {
+    if (!index) return;
+    free(index->variables);
+    free(index->vrs);
+    free(index->types);
+    free(index);
+}
+
 // the name is unique within a fmu
 ScalarVariable* getVariableByName(ModelDescription* md, const char* name) {
     int i;
+    if (md->index) {
+        NameSlot* ns = findNameSlot(md->index->variables, md->index->variablesMask, name, hashString(name));
+        return (ScalarVariable*)ns->element;
+    }
     if (md->modelVariables) {
         for (i=0; md->modelVariables[i]; i++){
             ScalarVariable* sv = (ScalarVariable*)md->modelVariables[i];
@@ -218,27 +374,46 @@ ScalarVariable* getVariableByName(ModelDescription* md, const char* name) {
 // Enumeration and Integer have the same base type while
 // Real, String, Boolean define own base types.
 int sameBaseType(Elm t1, Elm t2){
-    return t1==t2 ||
-        (t1==elm_Enumeration && t2==elm_Integer) ||
-        (t2==elm_Enumeration && t1==elm_Integer);
+    return baseType(t1) == baseType(t2);
 }
 
 // returns NULL if variable not found or vr==fmiUndefinedValueReference
-// problem: vr/type in not a unique key, may return alias
+// vr/type in not a unique key: if several variables share it, the one with
+// alias noAlias is returned, or the first of them if there is none
 ScalarVariable* getVariable(ModelDescription* md, fmiValueReference vr, Elm type){
     int i;
-    if (md->modelVariables && vr!=fmiUndefinedValueReference)
+    ScalarVariable* found = NULL;
+    if (vr == fmiUndefinedValueReference) return NULL;
+    if (md->index) return findVrSlot(md->index->vrs, md->index->vrsMask, vr, baseType(type))->sv;
+    if (md->modelVariables)
     for (i=0; md->modelVariables[i]; i++){
         ScalarVariable* sv = (ScalarVariable*)md->modelVariables[i];
-        if (sameBaseType(type, sv->typeSpec->type) && getValueReference(sv) == vr)
-            return sv;
+        if (sameBaseType(type, sv->typeSpec->type) && getValueReference(sv) == vr) {
+            if (getAlias(sv) == enu_noAlias) return sv;
+            if (!found) found = sv;
+        }
     }
-    return NULL;
+    return found;
+}
+
+// Returns the variable that sv is an alias of, i.e. the variable with alias
+// noAlias of the same base type and vr, or sv if there is none.
+// Use getAlias(sv) to tell if the value of sv is negated.
+ScalarVariable* getAliasBase(ModelDescription* md, ScalarVariable* sv){
+    ScalarVariable* base;
+    if (getAlias(sv) == enu_noAlias) return sv;
+    base = getVariable(md, getValueReference(sv), sv->typeSpec->type);
+    return base && getAlias(base) == enu_noAlias ? base : sv;
 }
 
 Type* getDeclaredType(ModelDescription* md, const char* declaredType){
     int i;
-    if (declaredType && md->typeDefinitions)
+    if (!declaredType) return NULL;
+    if (md->index) {
+        NameSlot* ns = findNameSlot(md->index->types, md->index->typesMask, declaredType, hashString(declaredType));
+        return (Type*)ns->element;
+    }
+    if (md->typeDefinitions)
     for (i=0; md->typeDefinitions[i]; i++){
         Type* tp = (Type*)md->typeDefinitions[i];
         if (!strcmp(declaredType, getName(tp))) return tp;
@@ -303,77 +478,160 @@ double getNominal(ModelDescription* md, fmiValueReference vr){
 // -------------------------------------------------------------------------
 // Various checks that log an error and stop the parser 
 
+// The checks take the context of the running parser, or NULL if not parsing.
+
 // Returns 0 to indicate error
-static int checkPointer(const void* ptr){
+static int checkPointer(ParserContext* ctx, const void* ptr){
     if (! ptr) {
         logThis(ERROR_FATAL, "Out of memory");
-        if (parser) XML_StopParser(parser, XML_FALSE);
+        if (ctx) XML_StopParser(ctx->parser, XML_FALSE);
         return 0; // error
     }
     return 1; // success
 }
 
-static int checkName(const char* name, const char* kind, const char* array[], int n){
+// -------------------------------------------------------------------------
+// Perfect hash tables for the names of elements, attributes and enum values.
+// The seed of the hash of a table is searched when the table is built, such
+// that each name of the vocabulary gets a slot of its own. Recognizing a name
+// then takes one hash and one strcmp. A table without a seed within
+// NAME_TABLE_MAX_SEED falls back to the linear search.
+
+#define NAME_TABLE_SIZE 1024        // slots, a power of 2 much larger than SIZEOF_ATT
+#define NAME_TABLE_MAX_SEED 10000
+
+typedef struct {
+    const char** names;
+    int n;
+    unsigned int seed;              // 0 if no seed has been found
+    short slots[NAME_TABLE_SIZE];   // index of the name in names, or -1
+} NameTable;
+
+static NameTable elmTable = { elmNames, SIZEOF_ELM, 0 };
+static NameTable attTable = { attNames, SIZEOF_ATT, 0 };
+static NameTable enuTable = { enuNames, SIZEOF_ENU, 0 };
+
+static unsigned int hashName(const char* name, unsigned int seed){
+    unsigned int h = 2166136261u ^ seed;
+    for (; *name; name++) h = (h ^ (unsigned char)*name) * 16777619u;
+    return (h ^ (h >> 15)) & (NAME_TABLE_SIZE - 1);
+}
+
+static void buildNameTable(NameTable* t){
+    unsigned int seed;
     int i;
-    for (i=0; i<n; i++) {
-        if (!strcmp(name, array[i])) return i;
+    for (seed = 1; seed <= NAME_TABLE_MAX_SEED; seed++) {
+        for (i = 0; i < NAME_TABLE_SIZE; i++) t->slots[i] = -1;
+        for (i = 0; i < t->n; i++) {
+            unsigned int h = hashName(t->names[i], seed);
+            if (t->slots[h] >= 0) break; // collision, try the next seed
+            t->slots[h] = (short)i;
+        }
+        if (i == t->n) {
+            t->seed = seed;
+            return;
+        }
     }
+    t->seed = 0;
+}
+
+static void buildNameTables(){
+    buildNameTable(&elmTable);
+    buildNameTable(&attTable);
+    buildNameTable(&enuTable);
+}
+
+// build the name tables once, also if several threads parse at the same time
+#ifdef _MSC_VER
+static volatile LONG nameTablesState = 0; // 0: not built, 1: being built, 2: built
+static void initNameTables(){
+    if (nameTablesState == 2) return;
+    if (InterlockedCompareExchange(&nameTablesState, 1, 0) == 0) {
+        buildNameTables();
+        InterlockedExchange(&nameTablesState, 2);
+    } else {
+        while (nameTablesState != 2) Sleep(0);
+    }
+}
+#else
+static pthread_once_t nameTablesOnce = PTHREAD_ONCE_INIT;
+static void initNameTables(){
+    pthread_once(&nameTablesOnce, buildNameTables);
+}
+#endif
+
+// Returns the index of name in the vocabulary of t, or -1 if not found
+static int findName(const NameTable* t, const char* name){
+    int i;
+    if (t->seed) {
+        i = t->slots[hashName(name, t->seed)];
+        return i >= 0 && !strcmp(name, t->names[i]) ? i : -1;
+    }
+    for (i=0; i<t->n; i++) {
+        if (!strcmp(name, t->names[i])) return i;
+    }
+    return -1;
+}
+
+static int checkName(ParserContext* ctx, const char* name, const char* kind, const NameTable* t){
+    int i = findName(t, name);
+    if (i >= 0) return i;
     logThis(ERROR_FATAL, "Illegal %s %s", kind, name);
-    XML_StopParser(parser, XML_FALSE);
+    if (ctx) XML_StopParser(ctx->parser, XML_FALSE);
     return -1;
 }
 
 // Returns elm_BAD_DEFINED to indicate error
-static Elm checkElement(const char* elm){
-    return (Elm)checkName(elm, "element", elmNames, SIZEOF_ELM);
+static Elm checkElement(ParserContext* ctx, const char* elm){
+    return (Elm)checkName(ctx, elm, "element", &elmTable);
 }
 
 // Returns att_BAD_DEFINED to indicate error
-static Att checkAttribute(const char* att){
-    return (Att)checkName(att, "attribute", attNames, SIZEOF_ATT);
+static Att checkAttribute(ParserContext* ctx, const char* att){
+    return (Att)checkName(ctx, att, "attribute", &attTable);
 }
 
 // Returns enu_BAD_DEFINED to indicate error
-static Enu checkEnumValue(const char* enu){
-    return (Enu)checkName(enu, "enum value", enuNames, SIZEOF_ENU);
+static Enu checkEnumValue(ParserContext* ctx, const char* enu){
+    return (Enu)checkName(ctx, enu, "enum value", &enuTable);
 }
 
-static void logFatalTypeError(const char* expected, Elm found) {
+static void logFatalTypeError(ParserContext* ctx, const char* expected, Elm found) {
     logThis(ERROR_FATAL, "Wrong element type, expected %s, found %s",
             expected, elmNames[found]);
-    XML_StopParser(parser, XML_FALSE);
+    XML_StopParser(ctx->parser, XML_FALSE);
 }
 
 // Returns 0 to indicate error
 // Verify that Element elm is of the given type
-static int checkElementType(void* element, Elm e) {
+static int checkElementType(ParserContext* ctx, void* element, Elm e) {
     Element* elm = (Element* )element;
     if (elm->type == e) return 1; // success
-    logFatalTypeError(elmNames[e], elm->type);
+    logFatalTypeError(ctx, elmNames[e], elm->type);
     return 0; // error
 }
 
 // Returns 0 to indicate error
 // Verify that the next stack element exists and is of the given type
 // If e==elm_BAD_DEFINED, the type check is omitted
-static int checkPeek(Elm e) {
-    if (stackIsEmpty(stack)) {
+static int checkPeek(ParserContext* ctx, Elm e) {
+    if (stackIsEmpty(ctx->stack)) {
         if (e == elm_BAD_DEFINED) {
             logThis(ERROR_FATAL, "Illegal document structure, got undefined value?  Perhaps an attribute needs to be added to the Elm typedef in xml_parser.h?");
         } else {
             logThis(ERROR_FATAL, "Illegal document structure, expected %s", elmNames[e]);
         }
-        XML_StopParser(parser, XML_FALSE);
+        XML_StopParser(ctx->parser, XML_FALSE);
         return 0; // error
     }
-    return e==elm_BAD_DEFINED ? 1 : checkElementType(stackPeek(stack), e);
+    return e==elm_BAD_DEFINED ? 1 : checkElementType(ctx, stackPeek(ctx->stack), e);
 }
 
 // Returns NULL to indicate error
 // Get the next stack element, it is of the given type.
 // If e==elm_BAD_DEFINED, the type check is omitted
-static void* checkPop(Elm e){
-    return checkPeek(e) ? stackPop(stack) : NULL;
+static void* checkPop(ParserContext* ctx, Elm e){
+    return checkPeek(ctx, e) ? stackPop(ctx->stack) : NULL;
 }
 
 // -------------------------------------------------------------------------
@@ -409,22 +667,22 @@ AstNodeType getAstNodeType(Elm e){
 // Copies the attr array and all values.
 // Replaces all attribute names by constant literal strings.
 // Converts the null-terminated array into an array of known size n.
-int addAttributes(Element* el, const char** attr) {
+static int addAttributes(ParserContext* ctx, Element* el, const char** attr) {
     int n;
     Att a;
     const char** att = NULL;
     for (n=0; attr[n]; n+=2);
     if (n>0) {
         att = (const char **)calloc(n, sizeof(char*));
-        if (!checkPointer(att)) return 0;
+        if (!checkPointer(ctx, att)) return 0;
     }
     for (n=0; attr[n]; n+=2) {
         char* value = strdup(attr[n+1]);
-        if (!checkPointer(value)) {
+        if (!checkPointer(ctx, value)) {
             free((void *)att);
             return 0;
         }
-        a = checkAttribute(attr[n]);
+        a = checkAttribute(ctx, attr[n]);
         if (a == att_BAD_DEFINED) {
             free(value);
             free((void *)att);
@@ -439,13 +697,13 @@ int addAttributes(Element* el, const char** attr) {
 }
 
 // Returns NULL to indicate error
-Element* newElement(Elm type, int size, const char** attr) {
+static Element* newElement(ParserContext* ctx, Elm type, int size, const char** attr) {
     Element* e = (Element*)calloc(1, size);
-    if (!checkPointer(e)) return NULL;
+    if (!checkPointer(ctx, e)) return NULL;
     e->type = type;
     e->attributes = NULL;
     e->n=0;
-    if (!addAttributes(e, attr)) {
+    if (!addAttributes(ctx, e, attr)) {
         free(e);
         return NULL;
     }
@@ -457,13 +715,14 @@ Element* newElement(Elm type, int size, const char** attr) {
 
 // Create and push a new element node
 static void XMLCALL startElement(void *context, const char *elm, const char **attr) {
+    ParserContext* ctx = (ParserContext*)context;
     Elm el;
     void* e;
     int size;
     //logThis(ERROR_INFO, "start %s", elm);
-    el = checkElement(elm);
+    el = checkElement(ctx, elm);
     if (el==elm_BAD_DEFINED) return; // error
-    skipData = (el != elm_Name); // skip element content for all elements but Name
+    ctx->skipData = (el != elm_Name); // skip element content for all elements but Name
     switch(getAstNodeType(el)){
         case astElement:          size = sizeof(Element); break;
         case astListElement:      size = sizeof(ListElement); break;
@@ -473,37 +732,45 @@ static void XMLCALL startElement(void *context, const char *elm, const char **at
         case astModelDescription: size = sizeof(ModelDescription); break;
         default: assert(0);
     }
-    e = newElement(el, size, attr);
-    if (checkPointer(e)) stackPush(stack, e);
+    e = newElement(ctx, el, size, attr);
+    if (!checkPointer(ctx, e)) return;
+    stackPush(ctx->stack, e);
+    // the children of a ListElement are collected in a frame of their own,
+    // which becomes the list in popList
+    if (getAstNodeType(el) == astListElement && !stackPushFrame(ctx->stack)) {
+        checkPointer(ctx, NULL); // out of memory
+    }
 }
 
-// Pop all elements of the given type from stack and
+// Pop the frame with the elements of the given type from stack and
 // add it to the ListElement that follows.
 // The ListElement remains on the stack.
-static void popList(Elm e) {
-    int n = 0;
-    Element** array;
-    Element* elm = (Element *)stackPop(stack);
-    while (elm->type == e) {
-        elm = (Element *)stackPop(stack);
-        n++;
-    }
-    stackPush(stack, elm); // push ListElement back to stack
-    array = (Element**)stackLastPopedAsArray0(stack, n); // NULL terminated list
-    if (getAstNodeType(elm->type)!=astListElement) {
+static void popList(ParserContext* ctx, Elm e) {
+    int i, n;
+    Element* elm;
+    Element** array = (Element**)stackPopFrame(ctx->stack, &n); // NULL terminated list
+    if (!checkPointer(ctx, array)) return;
+    for (i=0; i<n; i++) {
+        if (!checkElementType(ctx, array[i], e)) {
+            free(array);
+            return; // failure
+        }
+    }
+    elm = stackIsEmpty(ctx->stack) ? NULL : (Element *)stackPeek(ctx->stack);
+    if (!elm || getAstNodeType(elm->type)!=astListElement) {
         free(array);
         return; // failure
     }
     ((ListElement*)elm)->list = array;
-    return; // success only if list!=NULL
 }
 
 // Pop the children from the stack and
 // check for correct type and sequence of children
 static void XMLCALL endElement(void *context, const char *elm) {
+    ParserContext* ctx = (ParserContext*)context;
     Elm el;
     //logThis(ERROR_INFO, "  end %s", elm);
-    el = checkElement(elm);
+    el = checkElement(ctx, elm);
     switch(el) {
         case elm_fmiModelDescription:
             {
@@ -516,50 +783,50 @@ static void XMLCALL endElement(void *context, const char *elm) {
                  CoSimulation *cs = NULL;     // NULL or CoSimulation
                  ListElement* child;
 
-                 child = (ListElement *)checkPop(elm_BAD_DEFINED);
+                 child = (ListElement *)checkPop(ctx, elm_BAD_DEFINED);
                  if (!child) return;
                  if (child->type == elm_CoSimulation_StandAlone || child->type == elm_CoSimulation_Tool) {
                      cs = (CoSimulation*)child;
-                     child = (ListElement *)checkPop(elm_BAD_DEFINED);
+                     child = (ListElement *)checkPop(ctx, elm_BAD_DEFINED);
                      if (!child) return;
                  }
                  if (child->type == elm_ModelVariables){
                      mv = (ScalarVariable**)child->list;
                      free(child);
-                     child = (ListElement *)checkPop(elm_BAD_DEFINED);
+                     child = (ListElement *)checkPop(ctx, elm_BAD_DEFINED);
                      if (!child) return;
                  }
                  if (child->type == elm_VendorAnnotations){
                      va = (ListElement**)child->list;
                      free(child);
-                     child = (ListElement *)checkPop(elm_BAD_DEFINED);
+                     child = (ListElement *)checkPop(ctx, elm_BAD_DEFINED);
                      if (!child) return;
                  }
                  if (child->type == elm_DefaultExperiment){
                      de = (Element*)child;
-                     child = (ListElement *)checkPop(elm_BAD_DEFINED);
+                     child = (ListElement *)checkPop(ctx, elm_BAD_DEFINED);
                      if (!child) return;
                  }
                  if (child->type == elm_TypeDefinitions){
                      td = (Type**)child->list;
                      free(child);
-                     child = (ListElement *)checkPop(elm_BAD_DEFINED);
+                     child = (ListElement *)checkPop(ctx, elm_BAD_DEFINED);
                      if (!child) return;
                  }
                  if (child->type == elm_UnitDefinitions){
                      ud = (ListElement**)child->list;
                      free(child);
-                     child = (ListElement *)checkPop(elm_BAD_DEFINED);
+                     child = (ListElement *)checkPop(ctx, elm_BAD_DEFINED);
                      if (!child) return;
                  }
                  // work around bug of SimulationX 3.x which places Implementation at wrong location
                  if (!cs && (child->type == elm_CoSimulation_StandAlone || child->type == elm_CoSimulation_Tool)) {
                      cs = (CoSimulation*)child;
-                     child = (ListElement *)checkPop(elm_BAD_DEFINED);
+                     child = (ListElement *)checkPop(ctx, elm_BAD_DEFINED);
                      if (!child) return;
                  }
 
-                 if (!checkElementType(child, elm_fmiModelDescription)) return;
+                 if (!checkElementType(ctx, child, elm_fmiModelDescription)) return;
                  md = (ModelDescription*)child;
                  md->modelVariables = mv;
                  md->vendorAnnotations = va;
@@ -567,16 +834,16 @@ static void XMLCALL endElement(void *context, const char *elm) {
                  md->typeDefinitions = td;
                  md->unitDefinitions = ud;
                  md->cosimulation = cs;
-                 stackPush(stack, md);
+                 stackPush(ctx->stack, md);
                  break;
             }
         case elm_Implementation:
             {
                  // replace Implementation element
-                 void* cs = checkPop(elm_BAD_DEFINED);
-                 void* im = checkPop(elm_Implementation);
+                 void* cs = checkPop(ctx, elm_BAD_DEFINED);
+                 void* im = checkPop(ctx, elm_Implementation);
                  if (!cs || !im) return;
-                 stackPush(stack, cs);
+                 stackPush(ctx->stack, cs);
                  //printf("im=%x att=%x\n",im,((Element*)im)->attributes);
                  free(im);
                  el = ((Element*)cs)->type;
@@ -584,31 +851,31 @@ static void XMLCALL endElement(void *context, const char *elm) {
             }
         case elm_CoSimulation_StandAlone:
             {
-                 Element* ca = (Element *)checkPop(elm_Capabilities);
-                 CoSimulation* cs = (CoSimulation *)checkPop(elm_CoSimulation_StandAlone);
+                 Element* ca = (Element *)checkPop(ctx, elm_Capabilities);
+                 CoSimulation* cs = (CoSimulation *)checkPop(ctx, elm_CoSimulation_StandAlone);
                  if (!ca || !cs) return;
                  cs->capabilities = ca;
-                 stackPush(stack, cs);
+                 stackPush(ctx->stack, cs);
                  break;
             }
         case elm_CoSimulation_Tool:
             {
-                 ListElement* mo = (ListElement *)checkPop(elm_Model);
-                 Element* ca = (Element *)checkPop(elm_Capabilities);
-                 CoSimulation* cs = (CoSimulation *)checkPop(elm_CoSimulation_Tool);
+                 ListElement* mo = (ListElement *)checkPop(ctx, elm_Model);
+                 Element* ca = (Element *)checkPop(ctx, elm_Capabilities);
+                 CoSimulation* cs = (CoSimulation *)checkPop(ctx, elm_CoSimulation_Tool);
                  if (!ca || !mo || !cs) return;
                  cs->capabilities = ca;
                  cs->model = mo;
-                 stackPush(stack, cs);
+                 stackPush(ctx->stack, cs);
                  break;
             }
         case elm_Type:
             {
                 Type* tp;
-                Element* ts = (Element *)checkPop(elm_BAD_DEFINED);
+                Element* ts = (Element *)checkPop(ctx, elm_BAD_DEFINED);
                 if (!ts) return;
-                if (!checkPeek(elm_Type)) return;
-                tp = (Type*)stackPeek(stack);
+                if (!checkPeek(ctx, elm_Type)) return;
+                tp = (Type*)stackPeek(ctx->stack);
                 switch (ts->type) {
                     case elm_RealType:
                     case elm_IntegerType:
@@ -617,7 +884,7 @@ static void XMLCALL endElement(void *context, const char *elm) {
                     case elm_EnumerationType:
                         break;
                     default:
-                         logFatalTypeError("RealType or similar", ts->type);
+                         logFatalTypeError(ctx, "RealType or similar", ts->type);
                          return;
                 }
                 tp->typeSpec = ts;
@@ -627,16 +894,16 @@ static void XMLCALL endElement(void *context, const char *elm) {
             {
                 ScalarVariable* sv;
                 Element** list = NULL;
-                Element* child = (Element *)checkPop(elm_BAD_DEFINED);
+                Element* child = (Element *)checkPop(ctx, elm_BAD_DEFINED);
                 if (!child) return;
                 if (child->type==elm_DirectDependency){
                     list = ((ListElement*)child)->list;
                     free(child);
-                    child = (Element *)checkPop(elm_BAD_DEFINED);
+                    child = (Element *)checkPop(ctx, elm_BAD_DEFINED);
                     if (!child) return;
                 }
-                if (!checkPeek(elm_ScalarVariable)) return;
-                sv = (ScalarVariable*)stackPeek(stack);
+                if (!checkPeek(ctx, elm_ScalarVariable)) return;
+                sv = (ScalarVariable*)stackPeek(ctx->stack);
                 switch (child->type) {
                     case elm_Real:
                     case elm_Integer:
@@ -645,35 +912,35 @@ static void XMLCALL endElement(void *context, const char *elm) {
                     case elm_Enumeration:
                         break;
                     default:
-                         logFatalTypeError("Real or similar", child->type);
+                         logFatalTypeError(ctx, "Real or similar", child->type);
                          return;
                 }
                 sv->directDependencies = list;
                 sv->typeSpec = child;
                 break;
             }
-        case elm_ModelVariables:    popList(elm_ScalarVariable); break;
-        case elm_VendorAnnotations: popList(elm_Tool);break;
-        case elm_Tool:              popList(elm_Annotation); break;
-        case elm_TypeDefinitions:   popList(elm_Type); break;
-        case elm_EnumerationType:   popList(elm_Item); break;
-        case elm_UnitDefinitions:   popList(elm_BaseUnit); break;
-        case elm_BaseUnit:          popList(elm_DisplayUnitDefinition); break;
-        case elm_DirectDependency:  popList(elm_Name); break;
-        case elm_Model:             popList(elm_File); break;
+        case elm_ModelVariables:    popList(ctx, elm_ScalarVariable); break;
+        case elm_VendorAnnotations: popList(ctx, elm_Tool);break;
+        case elm_Tool:              popList(ctx, elm_Annotation); break;
+        case elm_TypeDefinitions:   popList(ctx, elm_Type); break;
+        case elm_EnumerationType:   popList(ctx, elm_Item); break;
+        case elm_UnitDefinitions:   popList(ctx, elm_BaseUnit); break;
+        case elm_BaseUnit:          popList(ctx, elm_DisplayUnitDefinition); break;
+        case elm_DirectDependency:  popList(ctx, elm_Name); break;
+        case elm_Model:             popList(ctx, elm_File); break;
         case elm_Name:
             {
                  // Exception: the name value is represented as element content.
                  // All other values of the XML file are represented using attributes.
-                 Element* name = (Element *)checkPop(elm_Name);
+                 Element* name = (Element *)checkPop(ctx, elm_Name);
                  if (!name) return;
                  name->n = 2;
                  name->attributes = (const char **)malloc(2*sizeof(char*));
                  name->attributes[0] = attNames[att_input];
-                 name->attributes[1] = data;
-                 data = NULL;
-                 skipData = 1; // stop recording element content
-                 stackPush(stack, name);
+                 name->attributes[1] = ctx->data;
+                 ctx->data = NULL;
+                 ctx->skipData = 1; // stop recording element content
+                 stackPush(ctx->stack, name);
                  break;
             }
         case elm_BAD_DEFINED: return; // illegal element error
@@ -683,7 +950,7 @@ static void XMLCALL endElement(void *context, const char *elm) {
     }
     // All children of el removed from the stack.
     // The top element must be of type el now.
-    checkPeek(el);
+    checkPeek(ctx, el);
 }
 
 // Called to handle element data, e.g. "xy" in <Name>xy</Name>
@@ -692,25 +959,26 @@ static void XMLCALL endElement(void *context, const char *elm) {
 // For some reason, if the element data is the empty string (Eg. <a></a>)
 // instead of an empty string with len == 0 we get "\n". The workaround is
 // to replace this with the empty string whenever we encounter "\n".
-void XMLCALL handleData(void *context, const XML_Char *s, int len) {
+static void XMLCALL handleData(void *context, const XML_Char *s, int len) {
+    ParserContext* ctx = (ParserContext*)context;
     int n;
-    if (skipData) return;
-    if (!data) {
+    if (ctx->skipData) return;
+    if (!ctx->data) {
         // start a new data string
         if (len == 1 && s[0] == '\n') {
-            data = strdup("");
+            ctx->data = strdup("");
         } else {
-            data = (char *)malloc(len + 1);
-            strncpy(data, s, len);
-            data[len] = '\0';
+            ctx->data = (char *)malloc(len + 1);
+            strncpy(ctx->data, s, len);
+            ctx->data[len] = '\0';
         }
     }
     else {
         // continue existing string
-        n = strlen(data) + len;
-        data = (char *)realloc(data, n+1);
-        strncat(data, s, len);
-        data[n] = '\0';
+        n = strlen(ctx->data) + len;
+        ctx->data = (char *)realloc(ctx->data, n+1);
+        strncat(ctx->data, s, len);
+        ctx->data[n] = '\0';
     }
     return;
 }
@@ -815,6 +1083,7 @@ void freeElement(void* element){
             freeList((void **)md->vendorAnnotations);
             freeList((void **)md->modelVariables);
             freeElement(md->cosimulation);
+            freeModelIndex(md->index);
             break;
         }
     }
@@ -856,53 +1125,132 @@ ModelDescription* validate(ModelDescription* md) {
 // -------------------------------------------------------------------------
 // Entry function parse() of the XML parser 
 
-static void cleanup(FILE *file) {
-    stackFree(stack);
-    stack = NULL;
-    XML_ParserFree(parser);
-    parser = NULL;
-    fclose(file);
+// A file mapped into memory for reading
+typedef struct {
+    const char* data;        // NULL for an empty file
+    size_t size;
+#ifdef _MSC_VER
+    HANDLE file;
+    HANDLE mapping;
+#endif
+} MappedFile;
+
+// Returns 0 to indicate failure
+static int mapFile(const char* path, MappedFile* m) {
+#ifdef _MSC_VER
+    LARGE_INTEGER size;
+    m->data = NULL;
+    m->mapping = NULL;
+    m->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (m->file == INVALID_HANDLE_VALUE) return 0;
+    if (!GetFileSizeEx(m->file, &size)) {
+        CloseHandle(m->file);
+        return 0;
+    }
+    m->size = (size_t)size.QuadPart;
+    if (m->size == 0) return 1;
+    m->mapping = CreateFileMappingA(m->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (m->mapping) m->data = (const char*)MapViewOfFile(m->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!m->data) {
+        if (m->mapping) CloseHandle(m->mapping);
+        CloseHandle(m->file);
+        return 0;
+    }
+    return 1;
+#else
+    struct stat st;
+    void* data;
+    int fd = open(path, O_RDONLY);
+    m->data = NULL;
+    if (fd < 0) return 0;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return 0;
+    }
+    m->size = (size_t)st.st_size;
+    if (m->size > 0) {
+        data = mmap(NULL, m->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return 0;
+        }
+        m->data = (const char*)data;
+    }
+    close(fd);
+    return 1;
+#endif
+}
+
+static void unmapFile(MappedFile* m) {
+#ifdef _MSC_VER
+    if (m->data) UnmapViewOfFile(m->data);
+    if (m->mapping) CloseHandle(m->mapping);
+    CloseHandle(m->file);
+#else
+    if (m->data) munmap((void*)m->data, m->size);
+#endif
+}
+
+// Returns 0 to indicate a parse error. The whole file is passed to expat in one
+// call, or in a few calls if it is larger than the int length of XML_Parse.
+static int parseMappedFile(XML_Parser parser, const MappedFile* m) {
+    size_t offset = 0;
+    do {
+        size_t n = m->size - offset;
+        if (n > INT_MAX) n = INT_MAX;
+        if (!XML_Parse(parser, m->data ? m->data + offset : "", (int)n, offset + n == m->size)) return 0;
+        offset += n;
+    } while (offset < m->size);
+    return 1;
 }
 
 // Returns NULL to indicate failure
 // Otherwise, return the root node md of the AST.
 // The receiver must call freeElement(md) to release AST memory.
+// parse() is reentrant: several files can be parsed concurrently.
 ModelDescription* parse(const char* xmlPath) {
     ModelDescription* md = NULL;
-    FILE *file;
-    int done = 0;
-    stack = stackNew(100, 10);
-    if (!checkPointer(stack)) return NULL; // failure
-    parser = XML_ParserCreate(NULL);
-    if (!checkPointer(parser)) return NULL; // failure
-    XML_SetElementHandler(parser, startElement, endElement);
-    XML_SetCharacterDataHandler(parser, handleData);
-    file = fopen(xmlPath, "rb");
-    if (file == NULL) {
+    ParserContext ctx;
+    MappedFile file;
+    initNameTables();
+    if (!mapFile(xmlPath, &file)) {
         logThis(ERROR_ERROR, "Cannot open file '%s'", xmlPath);
-        XML_ParserFree(parser);
         return NULL; // failure
     }
+    ctx.data = NULL;
+    ctx.skipData = 1;
+    ctx.stack = stackNew(16);
+    ctx.parser = ctx.stack ? XML_ParserCreate(NULL) : NULL;
+    if (!ctx.parser) {
+        logThis(ERROR_FATAL, "Out of memory");
+        if (ctx.stack) stackFree(ctx.stack);
+        unmapFile(&file);
+        return NULL; // failure
+    }
+    XML_SetUserData(ctx.parser, &ctx);
+    XML_SetElementHandler(ctx.parser, startElement, endElement);
+    XML_SetCharacterDataHandler(ctx.parser, handleData);
     logThis(ERROR_INFO, "parse %s", xmlPath);
-    while (!done) {
-        int n = fread(text, sizeof(char), XMLBUFSIZE, file);
-        if (n != XMLBUFSIZE) done = 1;
-        if (!XML_Parse(parser, text, n, done)){
-            logThis(ERROR_ERROR, "Parse error in file %s at line %d:\n%s\n",
-                    xmlPath,
-                    (int)XML_GetCurrentLineNumber(parser),
-                    XML_ErrorString(XML_GetErrorCode(parser)));
-            while (!stackIsEmpty(stack)) md = (ModelDescription *)stackPop(stack);
-            if (md) freeElement(md);
-            cleanup(file);
-            return NULL; // failure
-        }
+    if (!parseMappedFile(ctx.parser, &file)) {
+        logThis(ERROR_ERROR, "Parse error in file %s at line %d:\n%s\n",
+                xmlPath,
+                (int)XML_GetCurrentLineNumber(ctx.parser),
+                XML_ErrorString(XML_GetErrorCode(ctx.parser)));
+        while (!stackIsEmpty(ctx.stack)) md = (ModelDescription *)stackPop(ctx.stack);
+        if (md) freeElement(md);
+        md = NULL;
+    } else {
+        md = (ModelDescription *)stackPop(ctx.stack);
+        assert(stackIsEmpty(ctx.stack));
     }
-    md = (ModelDescription *)stackPop(stack);
-    assert(stackIsEmpty(stack));
-    cleanup(file);
+    free(ctx.data);
+    stackFree(ctx.stack);
+    XML_ParserFree(ctx.parser);
+    unmapFile(&file);
+    // if out of memory, the lookups search the lists instead
+    if (md) buildModelIndex(md);
     //printElement(1, md); // debug
-    return validate(md); // success if all refs are valid
+    return md ? validate(md) : NULL; // success if all refs are valid
 }
 
 // #define TEST
@@ -114,6 +114,9 @@ typedef struct {
     ListElement* model;      // non-NULL to support tool coupling, NULL for standalone
 } CoSimulation;
 
+// Hash indexes of the variables and types of a ModelDescription, see buildModelIndex
+typedef struct ModelIndex ModelIndex;
+
 // AST node for element ModelDescription
 typedef struct {
     Elm type;                // element type
@@ -125,6 +128,7 @@ typedef struct {
     ListElement** vendorAnnotations;  // NULL or null-terminated list of Tools
     ScalarVariable** modelVariables;  // NULL or null-terminated list of ScalarVariable
     CoSimulation* cosimulation;       // NULL if this ModelDescription is for model exchange only
+    ModelIndex*   index;              // NULL or hash indexes, built by parse()
 } ModelDescription;
 
 // types of AST nodes used to represent an element
@@ -163,8 +167,10 @@ Enu getCausality(void* scalarVariable);
 Enu getVariability(void* scalarVariable);
 Enu getAlias(void* scalarVariable);
 fmiValueReference getValueReference(void* scalarVariable);
+int buildModelIndex(ModelDescription* md);
 ScalarVariable* getVariableByName(ModelDescription* md, const char* name);
 ScalarVariable* getVariable(ModelDescription* md, fmiValueReference vr, Elm type);
+ScalarVariable* getAliasBase(ModelDescription* md, ScalarVariable* sv);
 Type* getDeclaredType(ModelDescription* md, const char* declaredType);
 const char* getString2(ModelDescription* md, void* sv, Att a);
 const char * getDescription(ModelDescription* md, ScalarVariable* sv);
@@ -0,0 +1,331 @@
+/* -------------------------------------------------------------------------
+ * main.cpp
+ * Implements parser_bench, which measures the FMI 2.0 model description
+ * parser of shared/parser on synthetic model descriptions.
+ * Command syntax: parser_bench [-x <reader>] [-j <threads>] [-d <dir>] [-o <file>] [-l <lookups>]
+ *                 <variables>
+ *   -x libxml2, tokenizer, parallel or lazy, see parseWithReader, defaults to libxml2,
+ *      or stream for streamModelDescription
+ *   -j number of threads of the parallel reader, defaults to the number of processors
+ *   -d directory of the generated files, defaults to the current directory
+ *   -o append the results to the given csv file, defaults to parser_bench.csv
+ *   -l number of variable lookups, defaults to 1000000
+ * The model description bench20_<variables>.xml is generated unless it
+ * exists. It has units, types, states and their derivatives, outputs,
+ * parameters, inputs, enumerations, aliases and a model structure with
+ * dependencies. It is parsed by XmlParser directly, the cache of
+ * parseCached is not used. One line is
+ * appended to the csv file, with a header if the file is new: parse time,
+ * time of the first access to the variables, which parses them for the
+ * lazy reader, peak resident set size of the process, bytes of the model
+ * description per variable, attribute values in the xml file not counted,
+ * and the rate of lookups of variables by name and by value reference. With -x stream, the
+ * variables and Unknowns are streamed instead and there are no lookups.
+ * Run it once per size and reader, the peak resident set size is that of
+ * the whole process.
+ * Copyright QTronic GmbH. All rights reserved.
+ * -------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef _MSC_VER
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <time.h>
+#include <sys/resource.h>
+#endif
+#include "XmlParserCApi.h"
+#include "XmlParser.h"
+#include "XmlElement.h"
+
+// number of distinct names looked up, cycled through for all lookups
+#define NAMES 65536
+
+static double now() {
+#ifdef _MSC_VER
+    LARGE_INTEGER count, frequency;
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&frequency);
+    return (double)count.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+#endif
+}
+
+// peak resident set size of the process in KB
+static long peakRss() {
+#ifdef _MSC_VER
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return (long)(counters.PeakWorkingSetSize / 1024);
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+// counts the streamed variables and Unknowns, reading typed attributes as a consumer would
+struct StreamCount {
+    long variables;
+    long unknowns;
+    double sum;
+};
+
+static int countVariable(void *context, ScalarVariable *sv, int index) {
+    StreamCount *count = (StreamCount *)context;
+    ValueStatus vs;
+    double start = getAttributeDouble(getTypeSpec(sv), att_start, &vs);
+    if (vs == valueDefined) count->sum += start;
+    count->sum += getValueReference(sv);
+    count->variables++;
+    return 1;
+}
+
+static int countUnknown(void *context, Elm list, Element *unknown) {
+    StreamCount *count = (StreamCount *)context;
+    ValueStatus vs;
+    count->sum += getAttributeInt(unknown, att_index, &vs);
+    count->unknowns++;
+    return 1;
+}
+
+// streams xmlPath, returns the number of variables streamed, -1 on errors
+static long streamVariables(char *xmlPath) {
+    ModelDescriptionCallbacks callbacks;
+    StreamCount count;
+    memset(&callbacks, 0, sizeof(callbacks));
+    memset(&count, 0, sizeof(count));
+    callbacks.onVariable = countVariable;
+    callbacks.onUnknown = countUnknown;
+    if (!streamModelDescription(xmlPath, &callbacks, &count)) return -1;
+    return count.variables;
+}
+
+// Variable i, with index i + 1, follows the pattern i % 8: a state, its derivative,
+// an output depending on the state and the parameter, a parameter, an integer input,
+// a boolean, an enumeration input, and an alias of the output. Value reference i,
+// except for the alias.
+static int generate(const char *path, int n) {
+    int i;
+    FILE *file = fopen(path, "w");
+    if (!file) return 0;
+    fprintf(file, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<fmiModelDescription fmiVersion=\"2.0\" modelName=\"bench\" guid=\"{bench20-%d}\""
+        " numberOfEventIndicators=\"0\">\n"
+        "<ModelExchange modelIdentifier=\"bench\"/>\n"
+        "<UnitDefinitions>\n"
+        "  <Unit name=\"rad\"><BaseUnit rad=\"1\"/><DisplayUnit name=\"deg\" factor=\"57.2957795130823\"/></Unit>\n"
+        "  <Unit name=\"m/s\"><BaseUnit m=\"1\" s=\"-1\"/><DisplayUnit name=\"km/h\" factor=\"3.6\"/></Unit>\n"
+        "</UnitDefinitions>\n"
+        "<TypeDefinitions>\n"
+        "  <SimpleType name=\"Angle\"><Real quantity=\"Angle\" unit=\"rad\" displayUnit=\"deg\"/></SimpleType>\n"
+        "  <SimpleType name=\"Velocity\"><Real quantity=\"Velocity\" unit=\"m/s\" min=\"0\"/></SimpleType>\n"
+        "  <SimpleType name=\"Mode\"><Enumeration><Item name=\"off\" value=\"1\"/>"
+        "<Item name=\"on\" value=\"2\"/></Enumeration></SimpleType>\n"
+        "</TypeDefinitions>\n"
+        "<DefaultExperiment startTime=\"0\" stopTime=\"1\"/>\n"
+        "<ModelVariables>\n", n);
+    for (i = 0; i < n; i++) {
+        switch (i % 8) {
+            case 0: fprintf(file, "  <ScalarVariable name=\"v%d\" valueReference=\"%d\" description=\"state %d\""
+                " causality=\"local\" variability=\"continuous\" initial=\"exact\">"
+                "<Real declaredType=\"Angle\" start=\"%d.5\"/></ScalarVariable>\n", i, i, i, i);
+                break;
+            case 1: fprintf(file, "  <ScalarVariable name=\"v%d\" valueReference=\"%d\" description=\"der(v%d)\">"
+                "<Real derivative=\"%d\"/></ScalarVariable>\n", i, i, i - 1, i);
+                break;
+            case 2: fprintf(file, "  <ScalarVariable name=\"v%d\" valueReference=\"%d\" causality=\"output\">"
+                "<Real declaredType=\"Velocity\"/></ScalarVariable>\n", i, i);
+                break;
+            case 3: fprintf(file, "  <ScalarVariable name=\"v%d\" valueReference=\"%d\" causality=\"parameter\""
+                " variability=\"fixed\"><Real start=\"%d\" nominal=\"10\"/></ScalarVariable>\n", i, i, i);
+                break;
+            case 4: fprintf(file, "  <ScalarVariable name=\"v%d\" valueReference=\"%d\" causality=\"input\""
+                " variability=\"discrete\"><Integer start=\"%d\" min=\"0\"/></ScalarVariable>\n", i, i, i);
+                break;
+            case 5: fprintf(file, "  <ScalarVariable name=\"v%d\" valueReference=\"%d\" variability=\"discrete\""
+                " initial=\"exact\"><Boolean start=\"true\"/></ScalarVariable>\n", i, i);
+                break;
+            case 6: fprintf(file, "  <ScalarVariable name=\"v%d\" valueReference=\"%d\" causality=\"input\""
+                " variability=\"discrete\"><Enumeration declaredType=\"Mode\" start=\"1\"/></ScalarVariable>\n",
+                i, i);
+                break;
+            case 7: fprintf(file, "  <ScalarVariable name=\"v%d\" valueReference=\"%d\">"
+                "<Real declaredType=\"Velocity\"/></ScalarVariable>\n", i, i - 5);
+                break;
+        }
+    }
+    fprintf(file, "</ModelVariables>\n<ModelStructure>\n  <Outputs>\n");
+    for (i = 2; i < n; i += 8) {
+        fprintf(file, "    <Unknown index=\"%d\" dependencies=\"%d %d\"/>\n", i + 1, i - 1, i + 2);
+    }
+    fprintf(file, "  </Outputs>\n  <Derivatives>\n");
+    for (i = 1; i < n; i += 8) {
+        fprintf(file, "    <Unknown index=\"%d\" dependencies=\"%d\" dependenciesKind=\"dependent\"/>\n",
+            i + 1, i);
+    }
+    fprintf(file, "  </Derivatives>\n  <InitialUnknowns>\n");
+    for (i = 1; i < n; i += 8) {
+        fprintf(file, "    <Unknown index=\"%d\" dependencies=\"%d\"/>\n", i + 1, i);
+        if (i + 1 < n) {
+            fprintf(file, "    <Unknown index=\"%d\" dependencies=\"%d %d\"/>\n", i + 2, i, i + 3);
+        }
+    }
+    fprintf(file, "  </InitialUnknowns>\n</ModelStructure>\n</fmiModelDescription>\n");
+    return fclose(file) == 0;
+}
+
+// append a line to the csv file output, returns 0 if it cannot be written
+static int writeResults(const char *output, const char *xmlPath, const char *readerName, int n, long bytes,
+        double parseTime, double accessTime, double bytesPerVariable, long lookups, long found,
+        double lookupRate) {
+    FILE *file = fopen(output, "a");
+    if (!file) {
+        printf("error: Could not write %s\n", output);
+        return 0;
+    }
+    fseek(file, 0, SEEK_END);
+    if (ftell(file) == 0) {
+        fprintf(file, "parser,reader,variables,bytes,parse_seconds,first_access_seconds,peak_rss_kb,"
+            "bytes_per_variable,lookups,found,lookups_per_second\n");
+    }
+    fprintf(file, "fmu20,%s,%d,%ld,%.6f,%.6f,%ld,%.1f,%ld,%ld,%.0f\n", readerName, n, bytes, parseTime,
+        accessTime, peakRss(), bytesPerVariable, lookups, found, lookupRate);
+    fclose(file);
+    printf("%s: %d variables parsed with %s in %.3f s, %.0f lookups per second\n", xmlPath, n, readerName,
+        parseTime + accessTime, lookupRate);
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    const char *dir = ".";
+    const char *output = "parser_bench.csv";
+    const char *readerName = "libxml2";
+    long lookups = 1000000;
+    int threads = 0;
+    int n = 0;
+    int i;
+    char xmlPath[1024];
+    char **names;
+    long bytes;
+    long found = 0;
+    double start, parseTime, accessTime, lookupTime;
+    double bytesPerVariable;
+    ModelDescription *md;
+    FILE *file;
+
+    for (i = 1; i < argc - 1; i += 2) {
+        if (!strcmp(argv[i], "-x")) readerName = argv[i + 1];
+        else if (!strcmp(argv[i], "-d")) dir = argv[i + 1];
+        else if (!strcmp(argv[i], "-o")) output = argv[i + 1];
+        else if (!strcmp(argv[i], "-l")) lookups = atol(argv[i + 1]);
+        else if (!strcmp(argv[i], "-j")) threads = atoi(argv[i + 1]);
+        else break;
+    }
+    if (i == argc - 1) n = atoi(argv[i]);
+    if (strcmp(readerName, "libxml2") && strcmp(readerName, "tokenizer")
+            && strcmp(readerName, "parallel") && strcmp(readerName, "lazy")
+            && strcmp(readerName, "stream")) {
+        n = 0;
+    }
+    if (n < 8 || lookups < 1 || threads < 0) {
+        printf("command syntax: %s [-x <reader>] [-j <threads>] [-d <dir>] [-o <file>] [-l <lookups>] "
+            "<variables>\n", argv[0]);
+        printf("   -x <reader> .... libxml2, tokenizer, parallel, lazy or stream, defaults to libxml2\n");
+        printf("   -j <threads> ... threads of the parallel reader, defaults to the number of processors\n");
+        printf("   -d <dir> ....... directory of the generated model descriptions, optional\n");
+        printf("   -o <file> ...... csv file the results are appended to, defaults to parser_bench.csv\n");
+        printf("   -l <lookups> ... number of variable lookups, defaults to 1000000\n");
+        printf("   <variables> .... number of variables of the model description, at least 8\n");
+        return EXIT_FAILURE;
+    }
+
+    sprintf(xmlPath, "%.1000s/bench20_%d.xml", dir, n);
+    file = fopen(xmlPath, "r");
+    if (file) {
+        fclose(file);
+    } else if (!generate(xmlPath, n)) {
+        printf("error: Could not write %s\n", xmlPath);
+        return EXIT_FAILURE;
+    }
+    file = fopen(xmlPath, "r");
+    fseek(file, 0, SEEK_END);
+    bytes = ftell(file);
+    fclose(file);
+
+    if (!strcmp(readerName, "stream")) {
+        start = now();
+        found = streamVariables(xmlPath);
+        parseTime = now() - start;
+        if (found != n) {
+            printf("error: Could not stream %s\n", xmlPath);
+            return EXIT_FAILURE;
+        }
+        return writeResults(output, xmlPath, readerName, n, bytes, parseTime, 0, 0, 0, found, 0) ? EXIT_SUCCESS
+            : EXIT_FAILURE;
+    }
+
+    start = now();
+    {
+        XmlParser parser(xmlPath, strcmp(readerName, "libxml2") != 0);
+        if (!strcmp(readerName, "parallel")) parser.setThreads(threads);
+        parser.setLazy(!strcmp(readerName, "lazy"));
+        md = parser.parse();
+    }
+    parseTime = now() - start;
+    if (!md) {
+        printf("error: Could not parse %s\n", xmlPath);
+        return EXIT_FAILURE;
+    }
+    start = now();
+    if (getScalarVariableSize(md) != n) {
+        printf("error: Could not parse the variables of %s\n", xmlPath);
+        freeModelDescription(md);
+        return EXIT_FAILURE;
+    }
+    accessTime = now() - start;
+    bytesPerVariable = (double)md->arena->size() / n;
+
+    // names of random variables, and every second lookup by value reference
+    names = (char **)malloc(NAMES * sizeof(char *));
+    srand(1);
+    for (i = 0; i < NAMES; i++) {
+        names[i] = (char *)malloc(16);
+        sprintf(names[i], "v%d", rand() % n);
+    }
+    start = now();
+    for (i = 0; i < lookups; i++) {
+        const char *name = names[i % NAMES];
+        if (i % 2 == 0) {
+            if (getVariable(md, name)) found++;
+        } else {
+            // the value reference of a Real: a state, derivative, output or parameter
+            int k = atoi(name + 1) & ~7;
+            if (getVariableByValueReference(md, elm_Real, (fmi2ValueReference)(k + (i >> 1) % 4))) found++;
+        }
+    }
+    lookupTime = now() - start;
+    for (i = 0; i < NAMES; i++) free(names[i]);
+    free(names);
+    freeModelDescription(md);
+    if (!writeResults(output, xmlPath, readerName, n, bytes, parseTime, accessTime, bytesPerVariable,
+            lookups, found, lookups / (lookupTime > 0 ? lookupTime : 1e-9))) {
+        return EXIT_FAILURE;
+    }
+    // all looked up variables exist in the generated model description
+    if (found != lookups) {
+        printf("error: %ld of %ld variables not found in %s\n", lookups - found, lookups, xmlPath);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
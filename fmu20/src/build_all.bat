@@ -8,6 +8,7 @@ rem ------------------------------------------------------------
 rem First argument %1 should be empty for win32, and '-win64' for win64 build.
 call build_fmusim_me %1
 call build_fmusim_cs %1
+call build_fmusim_log %1
 echo -----------------------------------------------------------
 echo Making the FMUs of the FmuSDK ...
 pushd models
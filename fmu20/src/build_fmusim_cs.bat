@@ -35,7 +35,7 @@ if defined VS80COMNTOOLS (call "%VS80COMNTOOLS%\vsvars32.bat") else ^
 goto noCompiler
 )
 
-set SRC=main.c ..\shared\sim_support.c ..\shared\parser\XmlParser.cpp ..\shared\parser\XmlElement.cpp ..\shared\parser\XmlParserCApi.cpp
+set SRC=main.c ..\shared\sim_support.c ..\shared\binary_log.c ..\shared\log_filter.c ..\shared\output.c ..\shared\log_queue.c ..\shared\result_stream.c ..\shared\telemetry.c ..\shared\parser\XmlParser.cpp ..\shared\parser\XmlElement.cpp ..\shared\parser\XmlParserCApi.cpp ..\shared\parser\XmlCache.cpp ..\shared\parser\XmlTokenizer.cpp
 set INC=/I..\shared\include /I..\shared /I..\shared\parser
 set OPTIONS=/DFMI_COSIMULATION /nologo /EHsc /DSTANDALONE_XML_PARSER /DLIBXML_STATIC
 
@@ -0,0 +1,65 @@
+@echo off 
+rem ------------------------------------------------------------
+rem This batch builds fmu20sim_log.exe, which renders binary logs as text
+rem Usage: build_fmusim_log.bat (-win64)
+rem Copyright QTronic GmbH. All rights reserved
+rem ------------------------------------------------------------
+
+setlocal
+
+echo -----------------------------------------------------------
+echo building fmu20sim_log.exe - binary log decoder
+echo -----------------------------------------------------------
+
+rem save env variable settings
+set PREV_PATH=%PATH%
+if defined INCLUDE set PREV_INCLUDE=%INLUDE%
+if defined LIB     set PREV_LIB=%LIB%
+if defined LIBPATH set PREV_LIBPATH=%LIBPATH%
+
+if "%1"=="-win64" (set x64=x64\) else set x64=
+
+rem setup the compiler
+if defined x64 (
+if not exist ..\..\bin\x64 mkdir ..\..\bin\x64
+if defined VS110COMNTOOLS (call "%VS110COMNTOOLS%\..\..\VC\vcvarsall.bat" x86_amd64) else ^
+if defined VS100COMNTOOLS (call "%VS100COMNTOOLS%\..\..\VC\vcvarsall.bat" x86_amd64) else ^
+if defined VS90COMNTOOLS (call "%VS90COMNTOOLS%\..\..\VC\vcvarsall.bat" x86_amd64) else ^
+if defined VS80COMNTOOLS (call "%VS80COMNTOOLS%\..\..\VC\vcvarsall.bat" x86_amd64) else ^
+goto noCompiler
+) else (
+if defined VS110COMNTOOLS (call "%VS110COMNTOOLS%\vsvars32.bat") else ^
+if defined VS100COMNTOOLS (call "%VS100COMNTOOLS%\vsvars32.bat") else ^
+if defined VS90COMNTOOLS (call "%VS90COMNTOOLS%\vsvars32.bat") else ^
+if defined VS80COMNTOOLS (call "%VS80COMNTOOLS%\vsvars32.bat") else ^
+goto noCompiler
+)
+
+set SRC=main.c ..\shared\binary_log.c
+set INC=/I..\shared
+set OPTIONS=/nologo
+
+rem create fmu20sim_log.exe in log_decoder dir
+pushd log_decoder
+cl %SRC% %INC% %OPTIONS% /Fefmu20sim_log.exe
+del *.obj
+popd
+if not exist log_decoder\fmu20sim_log.exe goto compileError
+move /Y log_decoder\fmu20sim_log.exe ..\..\bin\%x64%
+goto done
+
+:noCompiler
+echo No Microsoft Visual C compiler found
+
+:compileError
+echo build of fmu20sim_log.exe failed
+
+:done
+rem undo variable settings performed by vsvars32.bat
+set PATH=%PREV_PATH%
+if defined PREV_INCLUDE set INCLUDE=%PREV_INLUDE%
+if defined PREV_LIB     set LIB=%PREV_LIB%
+if defined PREV_LIBPATH set LIBPATH=%PREV_LIBPATH%
+echo done.
+
+endlocal
\ No newline at end of file
@@ -36,7 +36,7 @@ FMU fmu; // the fmu to simulate
 
 // simulate the given FMU from tStart = 0 to tEnd.
 static int simulate(FMU* fmu, double tEnd, double h, fmi2Boolean loggingOn, char separator,
-                    int nCategories, const fmi2String categories[]) {
+                    int nCategories, const fmi2String categories[], const Options *options) {
     double time;
     double tStart = 0;                      // start time
     const char *guid;                       // global unique id of the fmu
@@ -53,7 +53,8 @@ static int simulate(FMU* fmu, double tEnd, double h, fmi2Boolean loggingOn, char
     ValueStatus vs = 0;
     int nSteps = 0;
     Element *defaultExp;
-    FILE* file;
+    Output *output;                            // sinks of the simulation results
+    int result = 0;                            // 1 if the simulation succeeded
 
     // instantiate the fmu
     md = fmu->modelDescription;
@@ -90,16 +91,13 @@ static int simulate(FMU* fmu, double tEnd, double h, fmi2Boolean loggingOn, char
         return error("could not initialize model; failed FMI exit initialization mode");
     }
 
-    // open result file
-    if (!(file = fopen(RESULT_FILE, "w"))) {
-        printf("could not write %s because:\n", RESULT_FILE);
-        printf("    %s\n", strerror(errno));
+    // open result files
+    if (!(output = openOutput(fmu, separator, &options->output))) {
         return 0; // failure
     }
 
     // output solution for time t0
-    outputRow(fmu, c, tStart, file, separator, fmi2True);  // output column names
-    outputRow(fmu, c, tStart, file, separator, fmi2False); // output values
+    outputStep(output, c, tStart); // output values
 
     // enter the simulation loop
     time = tStart;
@@ -109,23 +107,34 @@ static int simulate(FMU* fmu, double tEnd, double h, fmi2Boolean loggingOn, char
             fmi2Boolean b;
             // check if model requests to end simulation
             if (fmi2OK != fmu->getBooleanStatus(c, fmi2Terminated, &b)) {
-                return error("could not complete simulation of the model. getBooleanStatus return other than fmi2OK");
+                error("could not complete simulation of the model. getBooleanStatus return other than fmi2OK");
+                goto cleanup;
             }
             if (b == fmi2True) {
-                return error("the model requested to end the simulation");
+                error("the model requested to end the simulation");
+                goto cleanup;
             }
-            return error("could not complete simulation of the model");
+            error("could not complete simulation of the model");
+            goto cleanup;
+        }
+        if (fmi2Flag != fmi2OK) {
+            error("could not complete simulation of the model");
+            goto cleanup;
         }
-        if (fmi2Flag != fmi2OK) return error("could not complete simulation of the model");
         time += h;
-        outputRow(fmu, c, time, file, separator, fmi2False); // output values for this step
+        outputStep(output, c, time); // output values for this step
         nSteps++;
     }
 
     // end simulation
     fmu->terminate(c);
     fmu->freeInstance(c);
-    fclose(file);
+    result = 1;
+
+cleanup:
+    // also after a failure, to write the results so far
+    closeOutput(output);
+    if (!result) return 0; // failure
 
     // print simulation summary
     printf("Simulation from %g to %g terminated successful\n", tStart, tEnd);
@@ -146,9 +155,11 @@ int main(int argc, char *argv[]) {
     char csv_separator = ',';
     fmi2String *categories = NULL;
     int nCategories = 0;
+    Options options;
 
-    parseArguments(argc, argv, &fmuFileName, &tEnd, &h, &loggingOn, &csv_separator, &nCategories, &categories);
-    loadFMU(fmuFileName);
+    parseArguments(argc, argv, &fmuFileName, &tEnd, &h, &loggingOn, &csv_separator, &nCategories, &categories,
+                   &options);
+    loadFMU(fmuFileName, &options);
 
   // run the simulation
     printf("FMU Simulator: run '%s' from t=0..%g with step size h=%g, loggingOn=%d, csv separator='%c' ",
@@ -157,8 +168,9 @@ int main(int argc, char *argv[]) {
     for (i = 0; i < nCategories; i++) printf("%s ", categories[i]);
     printf("}\n");
 
-    simulate(&fmu, tEnd, h, loggingOn, csv_separator, nCategories, categories);
-    printf("CSV file '%s' written\n", RESULT_FILE);
+    simulate(&fmu, tEnd, h, loggingOn, csv_separator, nCategories, categories, &options);
+    logQueueStop(); // write pending log messages
+    printOutputFiles(&options.output);
 
     // release FMU
 #ifdef _MSC_VER
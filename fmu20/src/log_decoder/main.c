@@ -0,0 +1,32 @@
+/* -------------------------------------------------------------------------
+ * main.c
+ * Implements fmusim_log, which renders a binary log written by fmusim_me
+ * or fmusim_cs with option -b as text, one line per message, in the same
+ * form as the messages are printed without option -b.
+ * Command syntax: fmusim_log [-t] <log file>
+ *   -t prefix each message with the time in seconds since the start
+ * The file format is described in shared/binary_log.h.
+ * Copyright QTronic GmbH. All rights reserved.
+ * -------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "binary_log.h"
+
+int main(int argc, char *argv[]) {
+    int withTime = 0;
+    const char *path;
+
+    if (argc == 3 && !strcmp(argv[1], "-t")) {
+        withTime = 1;
+        path = argv[2];
+    } else if (argc == 2) {
+        path = argv[1];
+    } else {
+        printf("command syntax: %s [-t] <log file>\n", argv[0]);
+        printf("   -t ............. prefix each message with the time in seconds since the start\n");
+        return EXIT_FAILURE;
+    }
+    return binaryLogDecode(path, stdout, withTime) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -38,7 +38,7 @@ FMU fmu; // the fmu to simulate
 // state events are checked and fired only at the end of an Euler step. 
 // the simulator may therefore miss state events and fires state events typically too late.
 static int simulate(FMU* fmu, double tEnd, double h, fmi2Boolean loggingOn, char separator,
-                    int nCategories, const fmi2String categories[]) {
+                    int nCategories, const fmi2String categories[], const Options *options) {
     int i;
     double dt, tPre;
     fmi2Boolean timeEvent, stateEvent, stepEvent, terminateSimulation;
@@ -65,7 +65,8 @@ static int simulate(FMU* fmu, double tEnd, double h, fmi2Boolean loggingOn, char
     int nTimeEvents = 0;
     int nStepEvents = 0;
     int nStateEvents = 0;
-    FILE* file;
+    Output *output;                  // sinks of the simulation results
+    int result = 0;                  // 1 if the simulation succeeded
     ValueStatus vs;
 
     // instantiate the fmu
@@ -96,10 +97,8 @@ static int simulate(FMU* fmu, double tEnd, double h, fmi2Boolean loggingOn, char
     }
     if ((!x || !xdot) || (nz>0 && (!z || !prez))) return error("out of memory");
 
-    // open result file
-    if (!(file = fopen(RESULT_FILE, "w"))) {
-        printf("could not write %s because:\n", RESULT_FILE);
-        printf("    %s\n", strerror(errno));
+    // open result files
+    if (!(output = openOutput(fmu, separator, &options->output))) {
         free (x);
         free(xdot);
         free(z);
@@ -111,17 +110,20 @@ static int simulate(FMU* fmu, double tEnd, double h, fmi2Boolean loggingOn, char
     time = tStart;
     fmi2Flag = fmu->setupExperiment(c, toleranceDefined, tolerance, tStart, fmi2True, tEnd);
     if (fmi2Flag > fmi2Warning) {
-        return error("could not initialize model; failed FMI setup experiment");
+        error("could not initialize model; failed FMI setup experiment");
+        goto cleanup;
     }
 
     // initialize
     fmi2Flag = fmu->enterInitializationMode(c);
     if (fmi2Flag > fmi2Warning) {
-        return error("could not initialize model; failed FMI enter initialization mode");
+        error("could not initialize model; failed FMI enter initialization mode");
+        goto cleanup;
     }
     fmi2Flag = fmu->exitInitializationMode(c);
     if (fmi2Flag > fmi2Warning) {
-        return error("could not initialize model; failed FMI exit initialization mode");
+        error("could not initialize model; failed FMI exit initialization mode");
+        goto cleanup;
     }
 
     // event iteration
@@ -130,7 +132,10 @@ static int simulate(FMU* fmu, double tEnd, double h, fmi2Boolean loggingOn, char
     while (eventInfo.newDiscreteStatesNeeded && !eventInfo.terminateSimulation) {
         // update discrete states
         fmi2Flag = fmu->newDiscreteStates(c, &eventInfo);
-        if (fmi2Flag > fmi2Warning) return error("could not set a new discrete state");
+        if (fmi2Flag > fmi2Warning) {
+            error("could not set a new discrete state");
+            goto cleanup;
+        }
     }
 
     if (eventInfo.terminateSimulation) {
@@ -139,16 +144,21 @@ static int simulate(FMU* fmu, double tEnd, double h, fmi2Boolean loggingOn, char
         // enter Continuous-Time Mode
         fmu->enterContinuousTimeMode(c);
         // output solution for time tStart
-        outputRow(fmu, c, tStart, file, separator, fmi2True);  // output column names
-        outputRow(fmu, c, tStart, file, separator, fmi2False); // output values
+        outputStep(output, c, tStart); // output values
 
         // enter the simulation loop
         while (time < tEnd) {
             // get current state and derivatives
             fmi2Flag = fmu->getContinuousStates(c, x, nx);
-            if (fmi2Flag > fmi2Warning) return error("could not retrieve states");
+            if (fmi2Flag > fmi2Warning) {
+                error("could not retrieve states");
+                goto cleanup;
+            }
             fmi2Flag = fmu->getDerivatives(c, xdot, nx);
-            if (fmi2Flag > fmi2Warning) return error("could not retrieve derivatives");
+            if (fmi2Flag > fmi2Warning) {
+                error("could not retrieve derivatives");
+                goto cleanup;
+            }
 
             // advance time
             tPre = time;
@@ -162,20 +172,29 @@ static int simulate(FMU* fmu, double tEnd, double h, fmi2Boolean loggingOn, char
             // perform one step
             for (i = 0; i < nx; i++) x[i] += dt * xdot[i]; // forward Euler method
             fmi2Flag = fmu->setContinuousStates(c, x, nx);
-            if (fmi2Flag > fmi2Warning) return error("could not set states");
+            if (fmi2Flag > fmi2Warning) {
+                error("could not set states");
+                goto cleanup;
+            }
             if (loggingOn) printf("Step %d to t=%.16g\n", nSteps, time);
 
             // check for state event
             for (i = 0; i < nz; i++) prez[i] = z[i];
             fmi2Flag = fmu->getEventIndicators(c, z, nz);
-            if (fmi2Flag > fmi2Warning) return error("could not retrieve event indicators");
+            if (fmi2Flag > fmi2Warning) {
+                error("could not retrieve event indicators");
+                goto cleanup;
+            }
             stateEvent = FALSE;
             for (i=0; i<nz; i++)
                 stateEvent = stateEvent || (prez[i] * z[i] < 0);
 
             // check for step event, e.g. dynamic state selection
             fmi2Flag = fmu->completedIntegratorStep(c, fmi2True, &stepEvent, &terminateSimulation);
-            if (fmi2Flag > fmi2Warning) return error("could not complete intgrator step");
+            if (fmi2Flag > fmi2Warning) {
+                error("could not complete intgrator step");
+                goto cleanup;
+            }
             if (terminateSimulation) {
                 printf("model requested termination at t=%.16g\n", time);
                 break; // success
@@ -205,7 +224,10 @@ static int simulate(FMU* fmu, double tEnd, double h, fmi2Boolean loggingOn, char
                 while (eventInfo.newDiscreteStatesNeeded && !eventInfo.terminateSimulation) {
                     // update discrete states
                     fmi2Flag = fmu->newDiscreteStates(c, &eventInfo);
-                    if (fmi2Flag > fmi2Warning) return error("could not set a new discrete state");
+                    if (fmi2Flag > fmi2Warning) {
+                        error("could not set a new discrete state");
+                        goto cleanup;
+                    }
                 }
                 if (eventInfo.terminateSimulation) {
                     printf("model requested termination at t=%.16g\n", time);
@@ -223,20 +245,27 @@ static int simulate(FMU* fmu, double tEnd, double h, fmi2Boolean loggingOn, char
                 if (eventInfo.nominalsOfContinuousStatesChanged && loggingOn){
                     printf("nominals of continuous state changed  at t=%.16g\n", time);
                 }
+                outputEvent(output, time, (OutputEvent)((timeEvent ? eventTime : 0) | (stateEvent ? eventState : 0)
+                        | (stepEvent ? eventStep : 0)));
 
             } // if event
-            outputRow(fmu, c, time, file, separator, fmi2False); // output values for this step
+            outputStep(output, c, time); // output values for this step
             nSteps++;
         } // while
     }
-    // cleanup
+    // end simulation
     fmu->terminate(c);
     fmu->freeInstance(c);
-    fclose(file);
+    result = 1;
+
+cleanup:
+    // also after a failure, to write the results so far
+    closeOutput(output);
     if (x != NULL) free(x);
     if (xdot != NULL) free(xdot);
     if (z != NULL) free(z);
     if (prez != NULL) free(prez);
+    if (!result) return 0; // failure
 
     // print simulation summary
     printf("Simulation from %g to %g terminated successful\n", tStart, tEnd);
@@ -261,9 +290,11 @@ int main(int argc, char *argv[]) {
     char csv_separator = ',';
     fmi2String *categories = NULL;
     int nCategories = 0;
+    Options options;
 
-    parseArguments(argc, argv, &fmuFileName, &tEnd, &h, &loggingOn, &csv_separator, &nCategories, &categories);
-    loadFMU(fmuFileName);
+    parseArguments(argc, argv, &fmuFileName, &tEnd, &h, &loggingOn, &csv_separator, &nCategories, &categories,
+                   &options);
+    loadFMU(fmuFileName, &options);
 
         // run the simulation
     printf("FMU Simulator: run '%s' from t=0..%g with step size h=%g, loggingOn=%d, csv separator='%c' ",
@@ -272,8 +303,9 @@ int main(int argc, char *argv[]) {
     for (i = 0; i < nCategories; i++) printf("%s ", categories[i]);
     printf("}\n");
 
-    simulate(&fmu, tEnd, h, loggingOn, csv_separator, nCategories, categories);
-    printf("CSV file '%s' written\n", RESULT_FILE);
+    simulate(&fmu, tEnd, h, loggingOn, csv_separator, nCategories, categories, &options);
+    logQueueStop(); // write pending log messages
+    printOutputFiles(&options.output);
 
     // release FMU
 #ifdef _MSC_VER
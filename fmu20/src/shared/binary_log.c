@@ -0,0 +1,719 @@
+/* -------------------------------------------------------------------------
+ * binary_log.c
+ * Binary log of fmuLogger and its decoder, see binary_log.h.
+ * Copyright QTronic GmbH. All rights reserved.
+ * -------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <time.h>
+#include "binary_log.h"
+
+#ifdef _MSC_VER
+#include <windows.h>
+typedef CRITICAL_SECTION Lock;
+#define initLock(l) InitializeCriticalSection(l)
+#define lockLog(l) EnterCriticalSection(l)
+#define unlockLog(l) LeaveCriticalSection(l)
+#else
+#include <pthread.h>
+typedef pthread_mutex_t Lock;
+#define initLock(l) pthread_mutex_init(l, NULL)
+#define lockLog(l) pthread_mutex_lock(l)
+#define unlockLog(l) pthread_mutex_unlock(l)
+#endif
+
+#define BYTE_ORDER_MARK 0x01020304u
+// maximum number of conversions of a format, others are formatted when logged
+#define MAX_CONVERSIONS 32
+// size of the buffer for messages formatted when logged
+#define FORMATTED_SIZE 1000
+// size of the buffer of the log file
+#define FILE_BUFFER_SIZE (1 << 16)
+
+// type of an argument of a format, in the order of the va_list
+typedef enum {
+    argInt,           // also char, short and unsigned types of this size, and * for width or precision
+    argLong,
+    argLongLong,
+    argSize,          // size_t, %zu
+    argIntMax,        // intmax_t, %jd
+    argPtrdiff,       // ptrdiff_t, %td
+    argDouble,        // also float
+    argLongDouble,    // stored as double
+    argString,
+    argPointer
+} ArgType;
+
+// a conversion of a format, e.g. %-*.3ld
+typedef struct {
+    const char *start;  // the '%'
+    int length;         // up to and including the conversion char
+    int nStars;         // number of * for width and precision, each consumes an int argument before the value
+    ArgType type;
+} Conversion;
+
+// Parse the conversions of format into conversions, %% is not a conversion.
+// Returns the number of conversions, or -1 if format contains a conversion that
+// is not supported, e.g. %n, %ls or %1$d, or more than MAX_CONVERSIONS conversions.
+static int parseFormat(const char *format, Conversion *conversions) {
+    int n = 0;
+    const char *p = format;
+    while ((p = strchr(p, '%')) != NULL) {
+        const char *start = p++;
+        char length = 0; // one of h, l, q (for ll), L, z, j, t or 0 for none
+        Conversion *c;
+        if (*p == '%') {
+            p++;
+            continue;
+        }
+        if (n == MAX_CONVERSIONS) return -1;
+        c = &conversions[n];
+        c->start = start;
+        c->nStars = 0;
+        while (*p && strchr("-+ #0", *p)) p++;
+        if (*p == '*') {
+            c->nStars++;
+            p++;
+        } else {
+            while (isdigit((unsigned char)*p)) p++;
+        }
+        if (*p == '$') return -1;
+        if (*p == '.') {
+            p++;
+            if (*p == '*') {
+                c->nStars++;
+                p++;
+            } else {
+                while (isdigit((unsigned char)*p)) p++;
+            }
+        }
+        switch (*p) {
+            case 'h':
+                p++;
+                if (*p == 'h') p++;
+                length = 'h';
+                break;
+            case 'l':
+                p++;
+                if (*p == 'l') {
+                    p++;
+                    length = 'q';
+                } else {
+                    length = 'l';
+                }
+                break;
+            case 'q': case 'L': case 'z': case 'j': case 't':
+                length = *p++;
+                break;
+        }
+        switch (*p) {
+            case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+                switch (length) {
+                    case 0: case 'h': c->type = argInt; break;
+                    case 'l': c->type = argLong; break;
+                    case 'q': c->type = argLongLong; break;
+                    case 'z': c->type = argSize; break;
+                    case 'j': c->type = argIntMax; break;
+                    case 't': c->type = argPtrdiff; break;
+                    default: return -1;
+                }
+                break;
+            case 'c':
+                if (length) return -1;
+                c->type = argInt;
+                break;
+            case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+                c->type = length == 'L' ? argLongDouble : argDouble;
+                break;
+            case 's':
+                if (length) return -1;
+                c->type = argString;
+                break;
+            case 'p':
+                c->type = argPointer;
+                break;
+            default:
+                return -1;
+        }
+        p++;
+        c->length = (int)(p - start);
+        n++;
+    }
+    return n;
+}
+
+// ----------------------------------------------------------------------------
+// Writer
+// ----------------------------------------------------------------------------
+
+// a string written to the string table. Open addressing by the address given by
+// the caller, which is compared with the copy, because the caller may reuse the
+// memory for another string.
+typedef struct {
+    const char *key;        // address of the string given by the caller, NULL for an empty slot
+    char *text;             // copy of the string
+    unsigned int id;
+    int nArgs;              // as a format: number of arguments, -1 if not supported, -2 if not yet parsed
+    unsigned char *args;    // as a format: ArgType of each argument
+} StringEntry;
+
+static FILE *file = NULL;
+static Lock lock;
+static StringEntry *strings = NULL;
+static unsigned int stringsMask = 0;   // number of slots - 1, the number of slots is a power of 2
+static unsigned int nStrings = 0;
+static unsigned int nextId = 0;
+static unsigned long long startTime = 0;
+static char *record = NULL;            // the message being written
+static size_t recordSize = 0;
+static size_t recordLength = 0;
+static const char *formattedFormat = "%s"; // format of messages formatted when logged
+
+static unsigned long long nanoseconds() {
+#ifdef _MSC_VER
+    LARGE_INTEGER count, frequency;
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&frequency);
+    return (unsigned long long)((double)count.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (unsigned long long)t.tv_sec * 1000000000ull + (unsigned long long)t.tv_nsec;
+#endif
+}
+
+static unsigned int hashPointer(const void *p) {
+    uintptr_t x = (uintptr_t)p;
+    return (unsigned int)((x >> 3) ^ (x >> 17)) * 2654435761u;
+}
+
+// append n bytes to record. Returns 0 to indicate failure.
+static int put(const void *data, size_t n) {
+    if (recordLength + n > recordSize) {
+        size_t size = recordSize ? recordSize : 256;
+        char *p;
+        while (size < recordLength + n) size *= 2;
+        p = (char *)realloc(record, size);
+        if (!p) return 0;
+        record = p;
+        recordSize = size;
+    }
+    memcpy(record + recordLength, data, n);
+    recordLength += n;
+    return 1;
+}
+
+static int putString(const char *s) {
+    unsigned int n = s ? (unsigned int)strlen(s) : BINARY_LOG_NULL;
+    return put(&n, 4) && (!s || put(s, n));
+}
+
+// double the number of slots of strings. Returns 0 to indicate failure.
+static int growStrings() {
+    unsigned int size = (stringsMask + 1) * 2;
+    StringEntry *old = strings;
+    unsigned int i;
+    unsigned int h;
+    strings = (StringEntry *)calloc(size, sizeof(StringEntry));
+    if (!strings) {
+        strings = old;
+        return 0;
+    }
+    for (i = 0; i <= stringsMask; i++) {
+        if (!old[i].key) continue;
+        for (h = hashPointer(old[i].key) & (size - 1); strings[h].key; h = (h + 1) & (size - 1));
+        strings[h] = old[i];
+    }
+    free(old);
+    stringsMask = size - 1;
+    return 1;
+}
+
+// Returns the entry of s, which is added to the string table if needed,
+// or NULL to indicate failure.
+static StringEntry *intern(const char *s) {
+    unsigned int h;
+    StringEntry *e;
+    char kind = 'S';
+    unsigned int n = (unsigned int)strlen(s);
+    if (2 * (nStrings + 1) > stringsMask + 1 && !growStrings()) return NULL;
+    for (h = hashPointer(s) & stringsMask; strings[h].key; h = (h + 1) & stringsMask) {
+        if (strings[h].key == s) break;
+    }
+    e = &strings[h];
+    if (e->key) {
+        if (!strcmp(e->text, s)) return e;
+        free(e->text);
+        free(e->args);
+    } else {
+        nStrings++;
+    }
+    e->key = s;
+    e->text = (char *)malloc(n + 1);
+    e->id = nextId++;
+    e->nArgs = -2;
+    e->args = NULL;
+    if (!e->text) {
+        e->key = NULL;
+        nStrings--;
+        return NULL;
+    }
+    memcpy(e->text, s, n + 1);
+    fwrite(&kind, 1, 1, file);
+    fwrite(&e->id, 4, 1, file);
+    fwrite(&n, 4, 1, file);
+    fwrite(s, 1, n, file);
+    return e;
+}
+
+// set nArgs and args of the format e
+static void parseArgs(StringEntry *e) {
+    Conversion conversions[MAX_CONVERSIONS];
+    int n = parseFormat(e->text, conversions);
+    int i;
+    int k = 0;
+    e->nArgs = -1;
+    if (n < 0) return;
+    e->args = (unsigned char *)malloc(3 * n + 1);
+    if (!e->args) return;
+    for (i = 0; i < n; i++) {
+        int j;
+        for (j = 0; j < conversions[i].nStars; j++) e->args[k++] = argInt;
+        e->args[k++] = (unsigned char)conversions[i].type;
+    }
+    e->nArgs = k;
+}
+
+int binaryLogOpen(const char *path) {
+    BinaryLogHeader header;
+    if (file) return 1;
+    file = fopen(path, "wb");
+    if (!file) {
+        printf("error: Could not open %s for writing\n", path);
+        return 0;
+    }
+    setvbuf(file, NULL, _IOFBF, FILE_BUFFER_SIZE);
+    strings = (StringEntry *)calloc(64, sizeof(StringEntry));
+    if (!strings) {
+        fclose(file);
+        file = NULL;
+        return 0;
+    }
+    stringsMask = 63;
+    nStrings = 0;
+    nextId = 0;
+    initLock(&lock);
+    memcpy(header.magic, BINARY_LOG_MAGIC, 8);
+    header.version = BINARY_LOG_VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.startTime = (long long)time(NULL);
+    fwrite(&header, sizeof(header), 1, file);
+    startTime = nanoseconds();
+    return 1;
+}
+
+int binaryLogIsOpen() {
+    return file != NULL;
+}
+
+void binaryLogVariable(char type, unsigned int vr, const char *name) {
+    char kind = 'V';
+    unsigned int n = (unsigned int)strlen(name);
+    if (!file) return;
+    lockLog(&lock);
+    fwrite(&kind, 1, 1, file);
+    fwrite(&type, 1, 1, file);
+    fwrite(&vr, 4, 1, file);
+    fwrite(&n, 4, 1, file);
+    fwrite(name, 1, n, file);
+    unlockLog(&lock);
+}
+
+void binaryLogMessage(int status, const char *instanceName, const char *category,
+        const char *format, va_list args) {
+    unsigned long long t = nanoseconds();
+    StringEntry *instance;
+    StringEntry *cat;
+    StringEntry *fmt;
+    unsigned char s = (unsigned char)status;
+    int ok;
+    int i;
+    if (!file) return;
+    lockLog(&lock);
+    if (!file) {
+        unlockLog(&lock);
+        return;
+    }
+    t -= startTime;
+    instance = intern(instanceName);
+    cat = intern(category);
+    fmt = intern(format);
+    if (fmt && fmt->nArgs == -2) parseArgs(fmt);
+    if (!instance || !cat || !fmt) {
+        unlockLog(&lock);
+        return;
+    }
+    recordLength = 0;
+    ok = put("M", 1) && put(&t, 8) && put(&s, 1) && put(&instance->id, 4) && put(&cat->id, 4);
+    if (fmt->nArgs < 0) {
+        // a conversion that is not supported, format now
+        static char formatted[FORMATTED_SIZE];
+        vsnprintf(formatted, FORMATTED_SIZE, format, args);
+        fmt = intern(formattedFormat);
+        ok = ok && fmt && put(&fmt->id, 4) && putString(formatted);
+    } else {
+        ok = ok && put(&fmt->id, 4);
+        for (i = 0; ok && i < fmt->nArgs; i++) {
+            union {
+                long long i;
+                unsigned long long u;
+                double d;
+            } v;
+            switch (fmt->args[i]) {
+                case argInt:        v.i = va_arg(args, int); break;
+                case argLong:       v.i = va_arg(args, long); break;
+                case argLongLong:   v.i = va_arg(args, long long); break;
+                case argSize:       v.u = va_arg(args, size_t); break;
+                case argIntMax:     v.i = (long long)va_arg(args, intmax_t); break;
+                case argPtrdiff:    v.i = va_arg(args, ptrdiff_t); break;
+                case argDouble:     v.d = va_arg(args, double); break;
+                case argLongDouble: v.d = (double)va_arg(args, long double); break;
+                case argPointer:    v.u = (uintptr_t)va_arg(args, void *); break;
+                case argString:
+                    ok = putString(va_arg(args, const char *));
+                    continue;
+            }
+            ok = put(&v, 8);
+        }
+    }
+    if (ok) fwrite(record, 1, recordLength, file);
+    unlockLog(&lock);
+}
+
+void binaryLogClose() {
+    unsigned int i;
+    if (!file) return;
+    lockLog(&lock);
+    fclose(file);
+    file = NULL;
+    for (i = 0; i <= stringsMask; i++) {
+        if (!strings[i].key) continue;
+        free(strings[i].text);
+        free(strings[i].args);
+    }
+    free(strings);
+    strings = NULL;
+    free(record);
+    record = NULL;
+    recordSize = 0;
+    unlockLog(&lock);
+}
+
+// ----------------------------------------------------------------------------
+// Reader
+// ----------------------------------------------------------------------------
+
+// growable text
+typedef struct {
+    char *s;
+    size_t length;
+    size_t size;
+} Text;
+
+// Returns 0 to indicate failure.
+static int reserve(Text *t, size_t n) {
+    if (t->length + n + 1 > t->size) {
+        size_t size = t->size ? t->size : 256;
+        char *p;
+        while (size < t->length + n + 1) size *= 2;
+        p = (char *)realloc(t->s, size);
+        if (!p) return 0;
+        t->s = p;
+        t->size = size;
+    }
+    return 1;
+}
+
+static int append(Text *t, const char *s, size_t n) {
+    if (!reserve(t, n)) return 0;
+    memcpy(t->s + t->length, s, n);
+    t->length += n;
+    t->s[t->length] = '\0';
+    return 1;
+}
+
+// append formatted text, like sprintf
+static int appendFormatted(Text *t, const char *format, ...) {
+    va_list args;
+    int n;
+    va_start(args, format);
+    n = vsnprintf(t->s + t->length, t->size - t->length, format, args);
+    va_end(args);
+    if (n < 0) return 0;
+    if ((size_t)n >= t->size - t->length) {
+        if (!reserve(t, n)) return 0;
+        va_start(args, format);
+        vsnprintf(t->s + t->length, t->size - t->length, format, args);
+        va_end(args);
+    }
+    t->length += n;
+    return 1;
+}
+
+typedef struct {
+    char type;
+    unsigned int vr;
+    char *name;
+} Variable;
+
+static int compareVariables(const void *a, const void *b) {
+    const Variable *x = (const Variable *)a;
+    const Variable *y = (const Variable *)b;
+    if (x->type != y->type) return x->type < y->type ? -1 : 1;
+    if (x->vr != y->vr) return x->vr < y->vr ? -1 : 1;
+    return 0;
+}
+
+static const char *statusToString(int status) {
+    static const char *names[] = {"ok", "warning", "discard", "error", "fatal", "fmi2Pending"};
+    return status >= 0 && status < 6 ? names[status] : "?";
+}
+
+// replace e.g. #r1365# by variable name and ## by # in msg, as fmuLogger does
+static int replaceRefs(const char *msg, Text *t, Variable *variables, int nVariables) {
+    const char *p = msg;
+    t->length = 0;
+    if (!append(t, "", 0)) return 0;
+    while (*p) {
+        const char *end;
+        const char *hash = strchr(p, '#');
+        if (!hash) return append(t, p, strlen(p));
+        if (!append(t, p, hash - p)) return 0;
+        end = strchr(hash + 1, '#');
+        if (!end) {
+            printf("unmatched '#' in '%s'\n", msg);
+            return append(t, "#", 1);
+        }
+        if (end == hash + 1) {
+            if (!append(t, "#", 1)) return 0;
+        } else {
+            Variable key;
+            Variable *v;
+            if (sscanf(hash + 2, "%u", &key.vr) != 1) {
+                printf("illegal value reference at position %d in '%s'\n", (int)(hash - msg) + 2, msg);
+                return append(t, "#", 1);
+            }
+            key.type = hash[1];
+            v = (Variable *)bsearch(&key, variables, nVariables, sizeof(Variable), compareVariables);
+            if (v) {
+                if (!append(t, v->name, strlen(v->name))) return 0;
+            } else {
+                if (!append(t, "?", 1)) return 0;
+            }
+        }
+        p = end + 1;
+    }
+    return 1;
+}
+
+// read n bytes. Returns 0 at the end of the file.
+static int readBytes(FILE *in, void *data, size_t n) {
+    return fread(data, 1, n, in) == n;
+}
+
+// read a string of the given length into a new buffer. Returns NULL to indicate failure.
+static char *readText(FILE *in, unsigned int n) {
+    char *s = (char *)malloc((size_t)n + 1);
+    if (!s) return NULL;
+    if (!readBytes(in, s, n)) {
+        free(s);
+        return NULL;
+    }
+    s[n] = '\0';
+    return s;
+}
+
+// format the message with the given format, reading the arguments from in.
+// Returns 0 to indicate failure.
+static int formatMessage(FILE *in, const char *format, Text *t) {
+    Conversion conversions[MAX_CONVERSIONS];
+    int n = parseFormat(format, conversions);
+    const char *p = format;
+    int i;
+    t->length = 0;
+    if (n < 0 || !append(t, "", 0)) return 0;
+    for (i = 0; i <= n; i++) {
+        // literal text up to the conversion, %% is replaced by %
+        const char *end = i < n ? conversions[i].start : format + strlen(format);
+        while (p < end) {
+            if (!append(t, p, 1)) return 0;
+            p += *p == '%' ? 2 : 1;
+        }
+        if (i < n) {
+            Conversion *c = &conversions[i];
+            char spec[128];
+            int k = 0;
+            int j;
+            union {
+                long long i;
+                unsigned long long u;
+                double d;
+            } v;
+            // copy the conversion, replacing each * by the value of its argument
+            for (j = 0; j < c->length; j++) {
+                if (c->start[j] == '*') {
+                    long long star;
+                    if (!readBytes(in, &star, 8)) return 0;
+                    k += snprintf(spec + k, sizeof(spec) - k, "%d", (int)star);
+                } else if (k < (int)sizeof(spec) - 1) {
+                    spec[k++] = c->start[j];
+                }
+                if (k >= (int)sizeof(spec)) return 0;
+            }
+            spec[k] = '\0';
+            if (c->type == argString) {
+                unsigned int length;
+                char *s;
+                int ok;
+                if (!readBytes(in, &length, 4)) return 0;
+                if (length == BINARY_LOG_NULL) {
+                    s = NULL;
+                } else {
+                    s = readText(in, length);
+                    if (!s) return 0;
+                }
+                ok = appendFormatted(t, spec, s ? s : "(null)");
+                free(s);
+                if (!ok) return 0;
+            } else {
+                int ok = 0;
+                if (!readBytes(in, &v, 8)) return 0;
+                switch (c->type) {
+                    case argInt:        ok = appendFormatted(t, spec, (int)v.i); break;
+                    case argLong:       ok = appendFormatted(t, spec, (long)v.i); break;
+                    case argLongLong:   ok = appendFormatted(t, spec, v.i); break;
+                    case argSize:       ok = appendFormatted(t, spec, (size_t)v.u); break;
+                    case argIntMax:     ok = appendFormatted(t, spec, (intmax_t)v.i); break;
+                    case argPtrdiff:    ok = appendFormatted(t, spec, (ptrdiff_t)v.i); break;
+                    case argDouble:     ok = appendFormatted(t, spec, v.d); break;
+                    case argLongDouble: ok = appendFormatted(t, spec, (long double)v.d); break;
+                    case argPointer:    ok = appendFormatted(t, spec, (void *)(uintptr_t)v.u); break;
+                    case argString:     break;
+                }
+                if (!ok) return 0;
+            }
+            p = c->start + c->length;
+        }
+    }
+    return 1;
+}
+
+int binaryLogDecode(const char *path, FILE *out, int withTime) {
+    FILE *in = fopen(path, "rb");
+    BinaryLogHeader header;
+    char **table = NULL;          // strings by id
+    unsigned int tableSize = 0;
+    Variable *variables = NULL;
+    int nVariables = 0;
+    int variablesSize = 0;
+    int sorted = 1;
+    Text formatted = {NULL, 0, 0};
+    Text msg = {NULL, 0, 0};
+    int ok = 1;
+    int kind;
+    unsigned int i;
+
+    if (!in) {
+        printf("error: Could not open %s\n", path);
+        return 0;
+    }
+    if (!readBytes(in, &header, sizeof(header)) || memcmp(header.magic, BINARY_LOG_MAGIC, 8)) {
+        printf("error: %s is not a binary log file\n", path);
+        fclose(in);
+        return 0;
+    }
+    if (header.byteOrder != BYTE_ORDER_MARK || header.version != BINARY_LOG_VERSION) {
+        printf("error: %s was written on a host of other byte order or by another version\n", path);
+        fclose(in);
+        return 0;
+    }
+    while (ok && (kind = fgetc(in)) != EOF) {
+        if (kind == 'S') {
+            unsigned int id;
+            unsigned int n;
+            ok = readBytes(in, &id, 4) && readBytes(in, &n, 4);
+            if (ok && id >= tableSize) {
+                unsigned int size = tableSize ? tableSize : 64;
+                char **p;
+                while (size <= id) size *= 2;
+                p = (char **)realloc(table, size * sizeof(char *));
+                if (p) {
+                    memset(p + tableSize, 0, (size - tableSize) * sizeof(char *));
+                    table = p;
+                    tableSize = size;
+                } else {
+                    ok = 0;
+                }
+            }
+            if (ok) {
+                free(table[id]);
+                table[id] = readText(in, n);
+                ok = table[id] != NULL;
+            }
+        } else if (kind == 'V') {
+            Variable v;
+            unsigned int n;
+            ok = readBytes(in, &v.type, 1) && readBytes(in, &v.vr, 4) && readBytes(in, &n, 4);
+            if (ok && nVariables == variablesSize) {
+                int size = variablesSize ? 2 * variablesSize : 64;
+                Variable *p = (Variable *)realloc(variables, size * sizeof(Variable));
+                if (p) {
+                    variables = p;
+                    variablesSize = size;
+                } else {
+                    ok = 0;
+                }
+            }
+            if (ok) {
+                v.name = readText(in, n);
+                ok = v.name != NULL;
+            }
+            if (ok) {
+                variables[nVariables++] = v;
+                sorted = 0;
+            }
+        } else if (kind == 'M') {
+            unsigned long long t;
+            unsigned char status;
+            unsigned int ids[3]; // instance name, category, format
+            ok = readBytes(in, &t, 8) && readBytes(in, &status, 1) && readBytes(in, ids, 12);
+            for (i = 0; ok && i < 3; i++) ok = ids[i] < tableSize && table[ids[i]];
+            if (ok && !sorted) {
+                qsort(variables, nVariables, sizeof(Variable), compareVariables);
+                sorted = 1;
+            }
+            ok = ok && formatMessage(in, table[ids[2]], &formatted)
+                    && replaceRefs(formatted.s, &msg, variables, nVariables);
+            if (ok) {
+                if (withTime) fprintf(out, "%.9f ", t / 1e9);
+                fprintf(out, "%s %s (%s): %s\n", statusToString(status), table[ids[0]], table[ids[1]], msg.s);
+            }
+        } else {
+            ok = 0;
+        }
+    }
+    if (!ok) printf("error: %s is corrupt or truncated\n", path);
+    fclose(in);
+    for (i = 0; i < tableSize; i++) free(table[i]);
+    free(table);
+    for (i = 0; i < (unsigned int)nVariables; i++) free(variables[i].name);
+    free(variables);
+    free(formatted.s);
+    free(msg.s);
+    return ok;
+}
@@ -0,0 +1,63 @@
+/* -------------------------------------------------------------------------
+ * binary_log.h
+ * Binary log of the FMU callback fmuLogger of fmusim_me and fmusim_cs.
+ * Instead of formatting each message with vsnprintf and replacing the
+ * references like #r12#, fmuLogger stores the raw arguments of the
+ * message. The format string, instance name and category are written
+ * once to a string table and referenced by id. The log is rendered to
+ * text later by the tool fmusim_log, which formats the messages exactly
+ * as fmuLogger would have done.
+ *
+ * Layout of the file, all numbers in the byte order of the host:
+ *   BinaryLogHeader
+ *   records, each a kind char followed by
+ *     'S' string:   id (4 bytes), length (4 bytes), the chars, not terminated
+ *     'V' variable: type char (one of r, i, b, s), value reference (4 bytes),
+ *                   length (4 bytes), the chars of the name, not terminated
+ *     'M' message:  time in nanoseconds since the start (8 bytes), status (1 byte),
+ *                   ids of instance name, category and format (4 bytes each),
+ *                   followed by one value per argument of the format:
+ *                   integers, pointers and floating point numbers (8 bytes),
+ *                   strings as length (4 bytes, BINARY_LOG_NULL for NULL) and chars
+ * A string or variable is written before the first message that uses it.
+ * Messages whose format contains a conversion that is not supported, e.g.
+ * %n or %ls, are formatted when logged and stored with format "%s".
+ * Copyright QTronic GmbH. All rights reserved.
+ * -------------------------------------------------------------------------*/
+
+#ifndef BINARY_LOG_H
+#define BINARY_LOG_H
+
+#include <stdio.h>
+#include <stdarg.h>
+
+#define BINARY_LOG_MAGIC "FMUSIMBL"
+#define BINARY_LOG_VERSION 1
+// length of a NULL string argument
+#define BINARY_LOG_NULL 0xFFFFFFFFu
+
+typedef struct {
+    char magic[8];                // BINARY_LOG_MAGIC, not terminated
+    unsigned int version;         // BINARY_LOG_VERSION
+    unsigned int byteOrder;       // 0x01020304, to detect a file written on a host of other byte order
+    long long startTime;          // wall clock time of the start in seconds since 1970
+} BinaryLogHeader;
+
+// Writer, used by fmuLogger: create the log file. Returns 0 to indicate failure.
+int binaryLogOpen(const char *path);
+// Returns 1 if the log file is open.
+int binaryLogIsOpen();
+// write the name of the variable of the given type, one of ribs, and value reference
+void binaryLogVariable(char type, unsigned int vr, const char *name);
+// write a message. May be called from several threads.
+void binaryLogMessage(int status, const char *instanceName, const char *category,
+        const char *format, va_list args);
+// flush and close the log file
+void binaryLogClose();
+
+// Reader: write the messages of the log file as text to out, one line per message,
+// each prefixed with the time in seconds since the start if withTime is 1.
+// Returns 0 to indicate failure.
+int binaryLogDecode(const char *path, FILE *out, int withTime);
+
+#endif // BINARY_LOG_H
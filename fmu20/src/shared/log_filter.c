@@ -0,0 +1,248 @@
+/* -------------------------------------------------------------------------
+ * log_filter.c
+ * Filtering and rate limiting of log messages, see log_filter.h.
+ * Copyright QTronic GmbH. All rights reserved.
+ * -------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "log_filter.h"
+
+#ifdef _MSC_VER
+#include <windows.h>
+typedef CRITICAL_SECTION Lock;
+#define initLock(l) InitializeCriticalSection(l)
+#define lockFilter(l) EnterCriticalSection(l)
+#define unlockFilter(l) LeaveCriticalSection(l)
+#else
+#include <pthread.h>
+typedef pthread_mutex_t Lock;
+#define initLock(l) pthread_mutex_init(l, NULL)
+#define lockFilter(l) pthread_mutex_lock(l)
+#define unlockFilter(l) pthread_mutex_unlock(l)
+#endif
+
+typedef struct {
+    char *instanceName;   // NULL for any instance
+    char *category;       // NULL for any category
+    int include;          // 1 to include, 0 to exclude the matched messages
+} Rule;
+
+// token bucket of an instance and category. Open addressing with linear probing.
+typedef struct {
+    char *instanceName;   // NULL for an empty slot
+    char *category;
+    unsigned int hash;
+    double tokens;
+    double time;          // of the last update of tokens, in seconds
+    double reportTime;    // of the last report, in seconds
+    unsigned long suppressed;  // number of messages suppressed and not yet reported
+} Bucket;
+
+static Rule *rules = NULL;
+static int nRules = 0;
+static double rate = 0;   // tokens per second, 0 for no rate limit
+static double burst = 0;  // maximum number of tokens
+static Bucket *buckets = NULL;
+static unsigned int bucketsMask = 0; // number of slots - 1, the number of slots is a power of 2
+static unsigned int nBuckets = 0;
+static Lock lock;
+
+static double seconds() {
+#ifdef _MSC_VER
+    LARGE_INTEGER count, frequency;
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&frequency);
+    return (double)count.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+#endif
+}
+
+// copy of s, or NULL for "*". Sets *ok to 0 if out of memory.
+static char *copyPattern(const char *s, size_t n, int *ok) {
+    char *p;
+    if (n == 1 && s[0] == '*') return NULL;
+    p = (char *)malloc(n + 1);
+    if (!p) {
+        *ok = 0;
+        return NULL;
+    }
+    memcpy(p, s, n);
+    p[n] = '\0';
+    return p;
+}
+
+int logFilterAddRule(const char *rule) {
+    const char *colon;
+    Rule *r;
+    int ok = 1;
+    Rule *p = (Rule *)realloc(rules, (nRules + 1) * sizeof(Rule));
+    if (!p) return 0;
+    rules = p;
+    r = &rules[nRules];
+    r->include = rule[0] != '-';
+    if (!r->include) rule++;
+    colon = strchr(rule, ':');
+    if (colon) {
+        r->instanceName = copyPattern(rule, colon - rule, &ok);
+        rule = colon + 1;
+    } else {
+        r->instanceName = NULL;
+    }
+    if (!rule[0]) {
+        free(r->instanceName);
+        return 0;
+    }
+    r->category = copyPattern(rule, strlen(rule), &ok);
+    if (!ok) {
+        free(r->instanceName);
+        free(r->category);
+        return 0;
+    }
+    nRules++;
+    return 1;
+}
+
+int logFilterSetRate(double r, double b) {
+    if (r <= 0 || b < 1) return 0;
+    if (!buckets) {
+        buckets = (Bucket *)calloc(64, sizeof(Bucket));
+        if (!buckets) return 0;
+        bucketsMask = 63;
+        initLock(&lock);
+    }
+    rate = r;
+    burst = b;
+    return 1;
+}
+
+int logFilterIsActive() {
+    return nRules > 0 || rate > 0;
+}
+
+static int matches(const char *pattern, const char *s) {
+    return !pattern || !strcmp(pattern, s);
+}
+
+// Returns 1 if the rules include messages of the given instance and category
+static int isIncluded(const char *instanceName, const char *category) {
+    int i;
+    for (i = nRules - 1; i >= 0; i--) {
+        if (matches(rules[i].instanceName, instanceName) && matches(rules[i].category, category)) {
+            return rules[i].include;
+        }
+    }
+    return !rules[0].include;
+}
+
+static unsigned int hashNames(const char *instanceName, const char *category) {
+    unsigned int h = 2166136261u;
+    const char *p;
+    for (p = instanceName; *p; p++) h = (h ^ (unsigned char)*p) * 16777619u;
+    h = (h ^ ':') * 16777619u;
+    for (p = category; *p; p++) h = (h ^ (unsigned char)*p) * 16777619u;
+    return h;
+}
+
+// double the number of slots of buckets. Returns 0 to indicate failure.
+static int growBuckets() {
+    unsigned int size = (bucketsMask + 1) * 2;
+    Bucket *old = buckets;
+    unsigned int i;
+    unsigned int h;
+    buckets = (Bucket *)calloc(size, sizeof(Bucket));
+    if (!buckets) {
+        buckets = old;
+        return 0;
+    }
+    for (i = 0; i <= bucketsMask; i++) {
+        if (!old[i].instanceName) continue;
+        for (h = old[i].hash & (size - 1); buckets[h].instanceName; h = (h + 1) & (size - 1));
+        buckets[h] = old[i];
+    }
+    free(old);
+    bucketsMask = size - 1;
+    return 1;
+}
+
+// Returns the bucket of the given instance and category, created with burst tokens
+// if needed, or NULL to indicate failure.
+static Bucket *getBucket(const char *instanceName, const char *category, double now) {
+    unsigned int hash = hashNames(instanceName, category);
+    unsigned int h;
+    Bucket *b;
+    if (2 * (nBuckets + 1) > bucketsMask + 1 && !growBuckets()) return NULL;
+    for (h = hash & bucketsMask; buckets[h].instanceName; h = (h + 1) & bucketsMask) {
+        b = &buckets[h];
+        if (b->hash == hash && !strcmp(b->instanceName, instanceName) && !strcmp(b->category, category)) {
+            return b;
+        }
+    }
+    b = &buckets[h];
+    b->instanceName = strdup(instanceName);
+    b->category = strdup(category);
+    if (!b->instanceName || !b->category) {
+        free(b->instanceName);
+        free(b->category);
+        b->instanceName = NULL;
+        return NULL;
+    }
+    b->hash = hash;
+    b->tokens = burst;
+    b->time = now;
+    b->reportTime = now;
+    b->suppressed = 0;
+    nBuckets++;
+    return b;
+}
+
+int logFilterAccept(const char *instanceName, const char *category, unsigned long *nSuppressed) {
+    double now;
+    Bucket *b;
+    int accept;
+    *nSuppressed = 0;
+    if (nRules > 0 && !isIncluded(instanceName, category)) return 0;
+    if (rate <= 0) return 1;
+    now = seconds();
+    lockFilter(&lock);
+    b = getBucket(instanceName, category, now);
+    if (!b) {
+        unlockFilter(&lock);
+        return 1;
+    }
+    b->tokens += (now - b->time) * rate;
+    if (b->tokens > burst) b->tokens = burst;
+    b->time = now;
+    accept = b->tokens >= 1;
+    if (accept) {
+        b->tokens -= 1;
+    } else {
+        b->suppressed++;
+    }
+    if (b->suppressed > 0 && (accept || now - b->reportTime >= LOG_SUMMARY_INTERVAL)) {
+        *nSuppressed = b->suppressed;
+        b->suppressed = 0;
+        b->reportTime = now;
+    }
+    unlockFilter(&lock);
+    return accept;
+}
+
+void logFilterFlush(LogSuppressedReporter report) {
+    unsigned int i;
+    if (!buckets) return;
+    lockFilter(&lock);
+    for (i = 0; i <= bucketsMask; i++) {
+        Bucket *b = &buckets[i];
+        if (b->instanceName && b->suppressed > 0) {
+            report(b->instanceName, b->category, b->suppressed);
+            b->suppressed = 0;
+        }
+    }
+    unlockFilter(&lock);
+}
@@ -0,0 +1,45 @@
+/* -------------------------------------------------------------------------
+ * log_filter.h
+ * Host side filtering and rate limiting of the messages of the FMU
+ * callback fmuLogger of fmusim_me and fmusim_cs.
+ *
+ * Filter rules have the form [<instance>:]<category>, where * matches any
+ * instance or category. A rule prefixed with - excludes the messages it
+ * matches, other rules include them. The last matching rule decides. A
+ * message that matches no rule is excluded if the first rule includes,
+ * and included otherwise. E.g. the rules logStatusError and -logEvents
+ * select only the errors, and -logEvents all messages but the events.
+ *
+ * Rate limiting is done with a token bucket per instance and category:
+ * the bucket holds up to burst tokens and gains rate tokens per second of
+ * wall clock time. A message takes one token and is suppressed if there
+ * is none. The number of suppressed messages is reported when a message
+ * of the bucket passes again, at most every LOG_SUMMARY_INTERVAL seconds
+ * while messages are suppressed, and by logFilterFlush.
+ * Copyright QTronic GmbH. All rights reserved.
+ * -------------------------------------------------------------------------*/
+
+#ifndef LOG_FILTER_H
+#define LOG_FILTER_H
+
+// seconds between the reports of a bucket while its messages are suppressed
+#define LOG_SUMMARY_INTERVAL 1.0
+
+// reports n messages of the given instance and category suppressed since the last report
+typedef void (*LogSuppressedReporter)(const char *instanceName, const char *category, unsigned long n);
+
+// add a filter rule, see above. Returns 0 to indicate failure.
+int logFilterAddRule(const char *rule);
+// limit the messages per instance and category to rate per second with the given burst.
+// Returns 0 to indicate failure.
+int logFilterSetRate(double rate, double burst);
+// Returns 1 if a rule or a rate limit is set.
+int logFilterIsActive();
+// Returns 1 if the message of the given instance and category is to be logged, 0 if it is
+// filtered or suppressed. Sets *nSuppressed to the number of suppressed messages to be
+// reported now, before the message if it is logged, or to 0. May be called from several threads.
+int logFilterAccept(const char *instanceName, const char *category, unsigned long *nSuppressed);
+// report the suppressed messages of all buckets that have not been reported yet
+void logFilterFlush(LogSuppressedReporter report);
+
+#endif // LOG_FILTER_H
@@ -0,0 +1,195 @@
+/* -------------------------------------------------------------------------
+ * log_queue.c
+ * Asynchronous logging through a bounded lock-free ring, see log_queue.h.
+ * Copyright QTronic GmbH. All rights reserved.
+ * -------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include "log_queue.h"
+
+#ifdef _MSC_VER
+
+int logQueueIsSupported() {
+    return 0;
+}
+
+int logQueueStart(LogOverflow overflow, LogWriter writer, LogDropReporter reporter) {
+    printf("error: Asynchronous logging is not supported on this platform\n");
+    return 0;
+}
+
+int logQueueEnter() {
+    return 0;
+}
+
+void logQueueLeave() {
+}
+
+LogRecord *logQueueAcquire() {
+    return NULL;
+}
+
+void logQueueCommit(LogRecord *record) {
+}
+
+void logQueueStop() {
+}
+
+#else
+
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+// number of polls of an empty ring before the background thread sleeps
+#define SPINS_BEFORE_SLEEP 64
+// sleep of the background thread when the ring is empty, in nanoseconds
+#define IDLE_SLEEP 200000
+
+typedef struct {
+    unsigned long long sequence;   // see log_queue.h
+    unsigned long long position;   // position of the record while claimed by a producer
+    LogRecord record;
+} Slot;
+
+static Slot *slots = NULL;
+static unsigned long long tail = 0;        // next position to claim, shared by the producers
+static unsigned long long head = 0;        // next position to read, used by the background thread only
+static unsigned long dropped = 0;          // number of records dropped and not yet reported
+static int stopping = 0;
+static int running = 0;
+static int producers = 0;                  // number of producers between logQueueEnter and logQueueLeave
+static LogOverflow overflowPolicy;
+static LogWriter writeRecord;
+static LogDropReporter reportDropped;
+static pthread_t thread;
+
+int logQueueIsSupported() {
+    return 1;
+}
+
+int logQueueEnter() {
+    // sequentially consistent with logQueueStop: either it sees this producer or the
+    // producer sees that the queue is stopping
+    __atomic_fetch_add(&producers, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&running, __ATOMIC_SEQ_CST)) return 1;
+    __atomic_fetch_sub(&producers, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void logQueueLeave() {
+    __atomic_fetch_sub(&producers, 1, __ATOMIC_RELEASE);
+}
+
+// write the records published so far. Returns the number of records written.
+static int drain() {
+    int n = 0;
+    for (;;) {
+        Slot *slot = &slots[head & (LOG_QUEUE_SIZE - 1)];
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != head + 1) break;
+        writeRecord(&slot->record);
+        // release the slot for the producer of position head + LOG_QUEUE_SIZE
+        __atomic_store_n(&slot->sequence, head + LOG_QUEUE_SIZE, __ATOMIC_RELEASE);
+        head++;
+        n++;
+    }
+    if (overflowPolicy == overflowCount) {
+        unsigned long nDropped = __atomic_exchange_n(&dropped, 0, __ATOMIC_RELAXED);
+        if (nDropped > 0) reportDropped(nDropped);
+    }
+    return n;
+}
+
+static void *run(void *arg) {
+    int idle = 0;
+    for (;;) {
+        if (drain() > 0) {
+            idle = 0;
+            continue;
+        }
+        // all claimed records are written when stopping
+        if (__atomic_load_n(&stopping, __ATOMIC_ACQUIRE) && __atomic_load_n(&tail, __ATOMIC_ACQUIRE) == head) {
+            break;
+        }
+        if (idle++ < SPINS_BEFORE_SLEEP) {
+            sched_yield();
+        } else {
+            struct timespec t = {0, IDLE_SLEEP};
+            fflush(stdout);
+            nanosleep(&t, NULL);
+        }
+    }
+    fflush(stdout);
+    return NULL;
+}
+
+int logQueueStart(LogOverflow overflow, LogWriter writer, LogDropReporter reporter) {
+    unsigned long long i;
+    if (running) return 1;
+    slots = (Slot *)calloc(LOG_QUEUE_SIZE, sizeof(Slot));
+    if (!slots) return 0;
+    for (i = 0; i < LOG_QUEUE_SIZE; i++) slots[i].sequence = i;
+    tail = head = 0;
+    dropped = 0;
+    stopping = 0;
+    producers = 0;
+    overflowPolicy = overflow;
+    writeRecord = writer;
+    reportDropped = reporter;
+    if (pthread_create(&thread, NULL, run, NULL) != 0) {
+        free(slots);
+        slots = NULL;
+        return 0;
+    }
+    __atomic_store_n(&running, 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+LogRecord *logQueueAcquire() {
+    unsigned long long position = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+    for (;;) {
+        Slot *slot = &slots[position & (LOG_QUEUE_SIZE - 1)];
+        unsigned long long sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        if (sequence == position) {
+            // the slot is free, claim it unless another producer was faster
+            if (__atomic_compare_exchange_n(&tail, &position, position + 1, 0, __ATOMIC_RELAXED,
+                    __ATOMIC_RELAXED)) {
+                slot->position = position;
+                return &slot->record;
+            }
+        } else if (sequence < position) {
+            // the ring is full
+            if (overflowPolicy != overflowBlock) {
+                __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+                return NULL;
+            }
+            sched_yield();
+            position = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+        } else {
+            // another producer claimed this position
+            position = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+void logQueueCommit(LogRecord *record) {
+    Slot *slot = (Slot *)((char *)record - offsetof(Slot, record));
+    __atomic_store_n(&slot->sequence, slot->position + 1, __ATOMIC_RELEASE);
+}
+
+void logQueueStop() {
+    if (!__atomic_load_n(&running, __ATOMIC_ACQUIRE)) return;
+    // let no more producers enter and wait for those inside, which have committed their
+    // records then; the background thread still makes room for a producer that blocks
+    __atomic_store_n(&running, 0, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&producers, __ATOMIC_SEQ_CST) > 0) sched_yield();
+    // the background thread ends when all records up to tail are written
+    __atomic_store_n(&stopping, 1, __ATOMIC_RELEASE);
+    pthread_join(thread, NULL);
+    free(slots);
+    slots = NULL;
+}
+
+#endif // _MSC_VER
@@ -0,0 +1,71 @@
+/* -------------------------------------------------------------------------
+ * log_queue.h
+ * Asynchronous logging for the FMU callback fmuLogger of fmusim_me and
+ * fmusim_cs. Log records are put into a bounded lock-free ring by any
+ * number of threads, e.g. FMU instances logging from worker threads, and
+ * written by a background thread, so that the simulation does not wait
+ * for terminal or pipe I/O.
+ *
+ * The ring is the bounded queue of D. Vyukov: each slot has a sequence
+ * number. A producer claims the slot at position tail by compare-and-swap
+ * of tail when the sequence of the slot equals tail, fills the record and
+ * publishes it by storing sequence = tail + 1. The consumer reads the slot
+ * at position head when its sequence equals head + 1 and releases it by
+ * storing sequence = head + LOG_QUEUE_SIZE.
+ *
+ * A producer enters the queue before it claims a slot and leaves it after
+ * the commit. logQueueStop first lets no more producers enter and waits
+ * until those inside have left, so that all claimed records are published
+ * and written before the ring is freed.
+ *
+ * Asynchronous logging requires POSIX threads and is not supported on
+ * Windows, where fmuLogger writes synchronously.
+ * Copyright QTronic GmbH. All rights reserved.
+ * -------------------------------------------------------------------------*/
+
+#ifndef LOG_QUEUE_H
+#define LOG_QUEUE_H
+
+// number of slots in the ring, a power of 2
+#define LOG_QUEUE_SIZE 1024
+#define LOG_NAME_SIZE 64
+#define LOG_MESSAGE_SIZE 1000
+
+// what a producer does when the ring is full
+typedef enum {
+    overflowBlock,  // wait until the background thread has made room
+    overflowDrop,   // drop the record
+    overflowCount   // drop the record and report the number of dropped records
+} LogOverflow;
+
+typedef struct {
+    int status;                          // an fmi2Status
+    char instanceName[LOG_NAME_SIZE];    // truncated if too long
+    char category[LOG_NAME_SIZE];        // truncated if too long
+    char message[LOG_MESSAGE_SIZE];      // formatted, but with references like #r12# not yet replaced
+} LogRecord;
+
+// writes a record, called by the background thread only
+typedef void (*LogWriter)(const LogRecord *record);
+// reports the number of records dropped since the last report, called by the background thread only
+typedef void (*LogDropReporter)(unsigned long n);
+
+// Returns 1 if asynchronous logging is supported by this build, 0 otherwise.
+int logQueueIsSupported();
+// start the background thread. Returns 0 to indicate failure.
+int logQueueStart(LogOverflow overflow, LogWriter writer, LogDropReporter reporter);
+// Enter the queue to put a record into it. Returns 1 if the background thread is running,
+// which it keeps doing until logQueueLeave, and 0 otherwise, the record is then to be
+// written synchronously and logQueueLeave must not be called.
+int logQueueEnter();
+// leave the queue entered by logQueueEnter
+void logQueueLeave();
+// claim a slot for a record, between logQueueEnter and logQueueLeave. Returns NULL if the
+// record is dropped.
+LogRecord *logQueueAcquire();
+// publish a record returned by logQueueAcquire
+void logQueueCommit(LogRecord *record);
+// write all published records and stop the background thread
+void logQueueStop();
+
+#endif // LOG_QUEUE_H
@@ -0,0 +1,820 @@
+/* -------------------------------------------------------------------------
+ * output.c
+ * Output of the simulation results of fmusim_me and fmusim_cs to a set
+ * of sinks, see output.h. The sinks are
+ *   csv      one row per output step with the values of all variables
+ *   changes  one row "time,name,value" per variable whose value changed
+ *   binary   one row of doubles per output step
+ *   shm      live telemetry in a shared memory segment, see telemetry.h
+ *   summary  final value, min, max, integral and RMS of selected variables
+ * Copyright QTronic GmbH. All rights reserved.
+ * -------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include "fmi2.h"
+#include "sim_support.h"
+
+struct Output {
+    FMU *fmu;
+    Sample sample;
+    int nSinks;
+    OutputSink *sinks[MAX_OUTPUT_SINKS + 1];
+};
+
+// creates a sink for the given argument, which is NULL if not given. Returns NULL to indicate failure.
+typedef OutputSink *(*SinkFactory)(const char *argument, char separator, const OutputOptions *options);
+
+static void *allocate(size_t n, size_t size) {
+    void *p = calloc(n > 0 ? n : 1, size);
+    if (!p) {
+        error("out of memory");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static void doubleToCommaString(char* buffer, double r){
+    char* comma;
+    sprintf(buffer, "%.16g", r);
+    comma = strchr(buffer, '.');
+    if (comma) *comma = ',';
+}
+
+// name of the given file, or the default name, followed by the suffix of the compression
+static const char *resultFileName(const char *argument, const char *defaultName, const OutputOptions *options) {
+    static char name[BUFSIZE];
+    snprintf(name, sizeof(name), "%s%s", argument ? argument : defaultName,
+            argument || options->compression == 0 ? "" : COMPRESSED_SUFFIX);
+    return name;
+}
+
+// open the result file with the given name. Returns NULL to indicate failure.
+static ResultStream *openResultFile(const char *name, const OutputOptions *options) {
+    ResultStream *file = resultStreamOpen(name, options->compression);
+    if (!file) {
+        printf("could not write %s because:\n", name);
+        printf("    %s\n", strerror(errno));
+    }
+    return file;
+}
+
+// output name of a variable as column name
+static void outputName(ResultStream* file, char separator, const char *name) {
+    if (separator == ',') {
+        // treat array element, e.g. print a[1, 2] as a[1.2]
+        const char *s = name;
+        resultStreamPrintf(file, "%c", separator);
+        while (*s) {
+            if (*s != ' ') {
+                resultStreamPrintf(file, "%c", *s == ',' ? '.' : *s);
+            }
+            s++;
+        }
+    } else {
+        resultStreamPrintf(file, "%c%s", separator, name);
+    }
+}
+
+// output a floating-point number, using ',' as decimal dot unless separator is ','
+static void outputReal(ResultStream* file, char separator, double r) {
+    char buffer[32];
+    if (separator == ',') {
+        resultStreamPrintf(file, "%.16g", r);
+    } else {
+        // separator is e.g. ';' or '\t'
+        doubleToCommaString(buffer, r);
+        resultStreamPrintf(file, "%s", buffer);
+    }
+}
+
+static const char *variableName(FMU *fmu, int k) {
+    return getAttributeValue((Element *)getScalarVariable(fmu->modelDescription, k), att_name);
+}
+
+// type char of the row column of a variable, as used by the binary and shm sinks
+static char columnType(Elm type) {
+    switch (type) {
+        case elm_Real:    return 'r';
+        case elm_Boolean: return 'b';
+        default:          return 'i';
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Sample
+// ---------------------------------------------------------------------------
+
+static void freeSample(Sample *sa) {
+    free(sa->types);
+    free(sa->index);
+    free(sa->row);
+    free(sa->strings);
+    free(sa->vrs);
+    free(sa->columns);
+    free(sa->reals);
+    free(sa->integers);
+    free(sa->booleans);
+    memset(sa, 0, sizeof(Sample));
+}
+
+// group the variables by base type for fetchSample
+static void initSample(Sample *sa, ModelDescription *md) {
+    int k;
+    int nVrs = 0;
+    int column;
+    int pass;
+    memset(sa, 0, sizeof(Sample));
+    sa->n = getScalarVariableSize(md);
+    sa->types = (Elm *)allocate(sa->n, sizeof(Elm));
+    sa->index = (int *)allocate(sa->n, sizeof(int));
+    sa->nColumns = 1;
+    for (k = 0; k < sa->n; k++) {
+        sa->types[k] = getElementType(getTypeSpec(getScalarVariable(md, k)));
+        sa->index[k] = -1;
+        switch (sa->types[k]) {
+            case elm_Real:        sa->nReals++; break;
+            case elm_Integer:
+            case elm_Enumeration: sa->nIntegers++; break;
+            case elm_Boolean:     sa->nBooleans++; break;
+            case elm_String:      sa->nStrings++; break;
+            default:              break;
+        }
+    }
+    sa->nColumns += sa->nReals + sa->nIntegers + sa->nBooleans;
+    sa->row = (double *)allocate(sa->nColumns, sizeof(double));
+    sa->strings = (fmi2String *)allocate(sa->nStrings, sizeof(fmi2String));
+    sa->vrs = (fmi2ValueReference *)allocate(sa->nColumns - 1 + sa->nStrings, sizeof(fmi2ValueReference));
+    sa->columns = (int *)allocate(sa->nColumns - 1, sizeof(int));
+    sa->reals = (fmi2Real *)allocate(sa->nReals, sizeof(fmi2Real));
+    sa->integers = (fmi2Integer *)allocate(sa->nIntegers, sizeof(fmi2Integer));
+    sa->booleans = (fmi2Boolean *)allocate(sa->nBooleans, sizeof(fmi2Boolean));
+
+    // columns are in the order of the variables, vrs are grouped by base type
+    for (k = 0, column = 1; k < sa->n; k++) {
+        switch (sa->types[k]) {
+            case elm_Real:
+            case elm_Integer:
+            case elm_Enumeration:
+            case elm_Boolean:     sa->index[k] = column++; break;
+            default:              break;
+        }
+    }
+    for (pass = 0; pass < 4; pass++) {
+        int nStrings = 0;
+        for (k = 0; k < sa->n; k++) {
+            Elm type = sa->types[k];
+            int group;
+            switch (type) {
+                case elm_Real:        group = 0; break;
+                case elm_Integer:
+                case elm_Enumeration: group = 1; break;
+                case elm_Boolean:     group = 2; break;
+                case elm_String:      group = 3; break;
+                default:              continue;
+            }
+            if (group != pass) continue;
+            if (group == 3) sa->index[k] = nStrings++;
+            else sa->columns[nVrs] = sa->index[k];
+            sa->vrs[nVrs++] = getValueReference(getScalarVariable(md, k));
+        }
+    }
+}
+
+// get the values of all variables at the given time
+static void fetchSample(Sample *sa, FMU *fmu, fmi2Component c, double time) {
+    const fmi2ValueReference *vrs = sa->vrs;
+    const int *columns = sa->columns;
+    int k;
+    sa->row[0] = time;
+    if (sa->nReals > 0) {
+        fmu->getReal(c, vrs, sa->nReals, sa->reals);
+        for (k = 0; k < sa->nReals; k++) sa->row[columns[k]] = sa->reals[k];
+        vrs += sa->nReals;
+        columns += sa->nReals;
+    }
+    if (sa->nIntegers > 0) {
+        fmu->getInteger(c, vrs, sa->nIntegers, sa->integers);
+        for (k = 0; k < sa->nIntegers; k++) sa->row[columns[k]] = sa->integers[k];
+        vrs += sa->nIntegers;
+        columns += sa->nIntegers;
+    }
+    if (sa->nBooleans > 0) {
+        fmu->getBoolean(c, vrs, sa->nBooleans, sa->booleans);
+        for (k = 0; k < sa->nBooleans; k++) sa->row[columns[k]] = sa->booleans[k];
+        vrs += sa->nBooleans;
+    }
+    if (sa->nStrings > 0) {
+        fmu->getString(c, vrs, sa->nStrings, sa->strings);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// csv sink: time and all variables in CSV format
+// if separator is ',', columns are separated by ',' and '.' is used for floating-point numbers.
+// otherwise, the given separator (e.g. ';' or '\t') is to separate columns, and ',' is used
+// as decimal dot in floating-point numbers.
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    OutputSink sink;
+    ResultStream *file;
+    char separator;
+} CsvSink;
+
+static int csvBegin(OutputSink *sink, FMU *fmu, const Sample *sa) {
+    CsvSink *csv = (CsvSink *)sink;
+    int k;
+    resultStreamPrintf(csv->file, "time");
+    for (k = 0; k < sa->n; k++) {
+        outputName(csv->file, csv->separator, variableName(fmu, k));
+    }
+    resultStreamPrintf(csv->file, "\n");
+    return 1;
+}
+
+static void csvRow(OutputSink *sink, const Sample *sa) {
+    CsvSink *csv = (CsvSink *)sink;
+    ResultStream *file = csv->file;
+    char separator = csv->separator;
+    int k;
+    outputReal(file, separator, sa->row[0]);
+    for (k = 0; k < sa->n; k++) {
+        switch (sa->types[k]) {
+            case elm_Real:
+                resultStreamPrintf(file, "%c", separator);
+                outputReal(file, separator, sa->row[sa->index[k]]);
+                break;
+            case elm_Integer:
+            case elm_Enumeration:
+            case elm_Boolean:
+                resultStreamPrintf(file, "%c%d", separator, (int)sa->row[sa->index[k]]);
+                break;
+            case elm_String:
+                resultStreamPrintf(file, "%c%s", separator, sa->strings[sa->index[k]]);
+                break;
+            default:
+                resultStreamPrintf(file, "%cNoValueForType=%d", separator, sa->types[k]);
+        }
+    }
+    resultStreamPrintf(file, "\n");
+}
+
+// also used by the changes and binary sinks
+static int csvEnd(OutputSink *sink) {
+    CsvSink *csv = (CsvSink *)sink;
+    int ok = resultStreamClose(csv->file);
+    free(csv);
+    return ok;
+}
+
+static OutputSink *csvCreate(const char *argument, char separator, const OutputOptions *options) {
+    CsvSink *csv;
+    ResultStream *file = openResultFile(resultFileName(argument, RESULT_FILE, options), options);
+    if (!file) return NULL;
+    csv = (CsvSink *)allocate(1, sizeof(CsvSink));
+    csv->sink.begin = csvBegin;
+    csv->sink.row = csvRow;
+    csv->sink.end = csvEnd;
+    csv->file = file;
+    csv->separator = separator;
+    return &csv->sink;
+}
+
+// ---------------------------------------------------------------------------
+// changes sink: time, name and value of each variable whose value changed since it was
+// last written. Integer, Enumeration, Boolean and String values are written when they
+// differ from the last written value, Real values when they differ by more than deadband.
+// The first row writes all variables, so that the file can be read by sample and hold.
+// See the csv sink for the meaning of separator.
+// ---------------------------------------------------------------------------
+
+// value of a variable as last written by the changes sink
+typedef struct {
+    fmi2Boolean written;  // false until the first value has been written
+    double v;             // last value of a Real, Integer, Enumeration or Boolean
+    char *s;              // copy of the last value of a String
+} LastValue;
+
+typedef struct {
+    CsvSink csv;
+    FMU *fmu;
+    double deadband;
+    int n;                // number of variables
+    LastValue *last;      // one per variable
+} ChangesSink;
+
+static int changesBegin(OutputSink *sink, FMU *fmu, const Sample *sa) {
+    ChangesSink *changes = (ChangesSink *)sink;
+    char separator = changes->csv.separator;
+    changes->fmu = fmu;
+    changes->n = sa->n;
+    changes->last = (LastValue *)allocate(sa->n, sizeof(LastValue));
+    resultStreamPrintf(changes->csv.file, "time%cname%cvalue\n", separator, separator);
+    return 1;
+}
+
+// Returns 1 if a Real changed from last to v by more than deadband, or became or stopped being
+// NaN, tested by v != v since isnan is not C89. Two NaN are equal.
+static int realChanged(double v, double last, double deadband) {
+    int isNaN = v != v;
+    int lastIsNaN = last != last;
+    if (isNaN || lastIsNaN) return isNaN != lastIsNaN;
+    return fabs(v - last) > deadband;
+}
+
+static void changesRow(OutputSink *sink, const Sample *sa) {
+    ChangesSink *changes = (ChangesSink *)sink;
+    ResultStream *file = changes->csv.file;
+    char separator = changes->csv.separator;
+    int k;
+
+    for (k = 0; k < sa->n; k++) {
+        LastValue *last = &changes->last[k];
+        Elm type = sa->types[k];
+        double v;
+        fmi2String s;
+        switch (type) {
+            case elm_Real:
+                v = sa->row[sa->index[k]];
+                if (last->written && !realChanged(v, last->v, changes->deadband)) continue;
+                last->v = v;
+                break;
+            case elm_Integer:
+            case elm_Enumeration:
+            case elm_Boolean:
+                v = sa->row[sa->index[k]];
+                if (last->written && v == last->v) continue;
+                last->v = v;
+                break;
+            case elm_String:
+                s = sa->strings[sa->index[k]];
+                if (!s) s = "";
+                if (last->written && !strcmp(s, last->s)) continue;
+                free(last->s);
+                last->s = strdup(s);
+                break;
+            default:
+                continue;
+        }
+        last->written = fmi2True;
+
+        outputReal(file, separator, sa->row[0]);
+        outputName(file, separator, variableName(changes->fmu, k));
+        switch (type) {
+            case elm_Real:   resultStreamPrintf(file, "%c", separator); outputReal(file, separator, last->v); break;
+            case elm_String: resultStreamPrintf(file, "%c%s", separator, last->s); break;
+            default:         resultStreamPrintf(file, "%c%d", separator, (int)last->v); break;
+        }
+        resultStreamPrintf(file, "\n");
+    }
+}
+
+static int changesEnd(OutputSink *sink) {
+    ChangesSink *changes = (ChangesSink *)sink;
+    int k;
+    if (changes->last) {
+        for (k = 0; k < changes->n; k++) free(changes->last[k].s);
+        free(changes->last);
+    }
+    return csvEnd(sink);
+}
+
+static OutputSink *changesCreate(const char *argument, char separator, const OutputOptions *options) {
+    ChangesSink *changes;
+    ResultStream *file = openResultFile(resultFileName(argument, RESULT_FILE, options), options);
+    if (!file) return NULL;
+    changes = (ChangesSink *)allocate(1, sizeof(ChangesSink));
+    changes->csv.sink.begin = changesBegin;
+    changes->csv.sink.row = changesRow;
+    changes->csv.sink.end = changesEnd;
+    changes->csv.file = file;
+    changes->csv.separator = separator;
+    changes->deadband = options->deadband;
+    return &changes->csv.sink;
+}
+
+// ---------------------------------------------------------------------------
+// binary sink: time and all Real, Integer, Enumeration and Boolean variables as one row
+// of doubles. String variables are not written. The file starts with the header
+//   "FMUSIM2B"            8 chars
+//   transform             unsigned int, a RowTransform
+//   n                     unsigned int, number of variables
+//   n times:  type        char, one of r, i, b
+//             length      unsigned int
+//             name        length chars, not terminated
+// followed by blocks of rows as described in result_stream.h, each row is time followed by
+// the n values. All numbers are written in the byte order of the host.
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    CsvSink csv;
+    RowTransform transform;
+} BinarySink;
+
+static int binaryBegin(OutputSink *sink, FMU *fmu, const Sample *sa) {
+    BinarySink *binary = (BinarySink *)sink;
+    ResultStream *file = binary->csv.file;
+    unsigned int nColumns = sa->nColumns - 1;
+    int k;
+    resultStreamWrite(file, "FMUSIM2B", 8);
+    resultStreamWrite(file, &binary->transform, sizeof(unsigned int));
+    resultStreamWrite(file, &nColumns, sizeof(unsigned int));
+    for (k = 0; k < sa->n; k++) {
+        const char *name = variableName(fmu, k);
+        unsigned int length = strlen(name);
+        char type = columnType(sa->types[k]);
+        if (sa->index[k] < 1 || sa->types[k] == elm_String) continue;
+        resultStreamWrite(file, &type, 1);
+        resultStreamWrite(file, &length, sizeof(unsigned int));
+        resultStreamWrite(file, name, length);
+    }
+    resultStreamBeginRows(file, sa->nColumns, binary->transform);
+    return 1;
+}
+
+static void binaryRow(OutputSink *sink, const Sample *sa) {
+    resultStreamWriteRow(((BinarySink *)sink)->csv.file, sa->row);
+}
+
+static OutputSink *binaryCreate(const char *argument, char separator, const OutputOptions *options) {
+    BinarySink *binary;
+    ResultStream *file = openResultFile(resultFileName(argument, RESULT_FILE_BINARY, options), options);
+    if (!file) return NULL;
+    binary = (BinarySink *)allocate(1, sizeof(BinarySink));
+    binary->csv.sink.begin = binaryBegin;
+    binary->csv.sink.row = binaryRow;
+    binary->csv.sink.end = csvEnd;
+    binary->csv.file = file;
+    binary->transform = options->transform;
+    return &binary->csv.sink;
+}
+
+// ---------------------------------------------------------------------------
+// shm sink: the row of the sample in the telemetry segment given as argument
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    OutputSink sink;
+    const char *name;
+    Telemetry *telemetry;
+} ShmSink;
+
+static int shmBegin(OutputSink *sink, FMU *fmu, const Sample *sa) {
+    ShmSink *shm = (ShmSink *)sink;
+    const char **names = (const char **)allocate(sa->nColumns, sizeof(char *));
+    char *types = (char *)allocate(sa->nColumns, sizeof(char));
+    int k;
+    names[0] = "time";
+    types[0] = 'r';
+    for (k = 0; k < sa->n; k++) {
+        int column = sa->index[k];
+        if (sa->types[k] == elm_String || column < 1) continue;
+        names[column] = variableName(fmu, k);
+        types[column] = columnType(sa->types[k]);
+    }
+    shm->telemetry = telemetryOpen(shm->name, sa->nColumns, types, names, TELEMETRY_ROWS);
+    free(names);
+    free(types);
+    return shm->telemetry != NULL;
+}
+
+static void shmRow(OutputSink *sink, const Sample *sa) {
+    telemetryWriteRow(((ShmSink *)sink)->telemetry, sa->row);
+}
+
+static void shmEvent(OutputSink *sink, double time, OutputEvent kinds) {
+    telemetryCountEvent(((ShmSink *)sink)->telemetry);
+}
+
+static int shmEnd(OutputSink *sink) {
+    ShmSink *shm = (ShmSink *)sink;
+    if (shm->telemetry) telemetryClose(shm->telemetry);
+    free(shm);
+    return 1;
+}
+
+static OutputSink *shmCreate(const char *argument, char separator, const OutputOptions *options) {
+    ShmSink *shm;
+    if (!telemetryIsSupported()) {
+        printf("error: Shared memory telemetry is not supported on this platform\n");
+        return NULL;
+    }
+    if (!argument || argument[0] != '/' || strchr(argument + 1, '/')) {
+        printf("error: The shm sink requires a shared memory name of the form /name\n");
+        return NULL;
+    }
+    shm = (ShmSink *)allocate(1, sizeof(ShmSink));
+    shm->sink.begin = shmBegin;
+    shm->sink.row = shmRow;
+    shm->sink.event = shmEvent;
+    shm->sink.end = shmEnd;
+    shm->name = argument;
+    return &shm->sink;
+}
+
+// ---------------------------------------------------------------------------
+// summary sink: reduces each selected variable online to its final value, minimum and
+// maximum with the time they are first reached, integral over time, mean and RMS value.
+// Integrals use the trapezoidal rule over the possibly varying output steps, summed with
+// compensated (Neumaier) summation. One line per variable is written by end:
+//   name,final,min,max,timeOfMin,timeOfMax,integral,mean,rms
+// See the csv sink for the meaning of separator.
+// ---------------------------------------------------------------------------
+
+// sum of many terms with a running compensation of the rounding errors
+typedef struct {
+    double sum;
+    double compensation;
+} Sum;
+
+static void addToSum(Sum *s, double x) {
+    double t = s->sum + x;
+    if (fabs(s->sum) >= fabs(x)) s->compensation += (s->sum - t) + x;
+    else s->compensation += (x - t) + s->sum;
+    s->sum = t;
+}
+
+static double getSum(const Sum *s) {
+    return s->sum + s->compensation;
+}
+
+// reduction of one variable
+typedef struct {
+    const char *name;
+    int column;           // column in the row of the sample
+    double last;          // value at the last row
+    double min;
+    double max;
+    double timeOfMin;
+    double timeOfMax;
+    Sum integral;         // integral of the value over time
+    Sum integralOfSquare; // integral of the square of the value over time
+} Reducer;
+
+typedef struct {
+    CsvSink csv;
+    const OutputOptions *options;
+    int nReducers;
+    Reducer *reducers;
+    long nRows;           // number of rows reduced so far
+    double tStart;        // time of the first row
+    double tLast;         // time of the last row
+} SummarySink;
+
+static int summaryBegin(OutputSink *sink, FMU *fmu, const Sample *sa) {
+    SummarySink *summary = (SummarySink *)sink;
+    const OutputOptions *options = summary->options;
+    int i, k;
+    if (options->nSummaryVariables == 0) {
+        summary->reducers = (Reducer *)allocate(sa->nColumns - 1, sizeof(Reducer));
+        for (k = 0; k < sa->n; k++) {
+            if (sa->types[k] == elm_String || sa->index[k] < 1) continue;
+            summary->reducers[summary->nReducers].name = variableName(fmu, k);
+            summary->reducers[summary->nReducers++].column = sa->index[k];
+        }
+        return 1;
+    }
+    summary->reducers = (Reducer *)allocate(options->nSummaryVariables, sizeof(Reducer));
+    for (i = 0; i < options->nSummaryVariables; i++) {
+        const char *name = options->summaryVariables[i];
+        for (k = 0; k < sa->n; k++) {
+            if (!strcmp(variableName(fmu, k), name)) break;
+        }
+        if (k == sa->n || sa->types[k] == elm_String || sa->index[k] < 1) {
+            printf("error: The summary variable %s is not a Real, Integer, Enumeration or Boolean variable\n",
+                    name);
+            return 0;
+        }
+        summary->reducers[summary->nReducers].name = name;
+        summary->reducers[summary->nReducers++].column = sa->index[k];
+    }
+    return 1;
+}
+
+static void summaryRow(OutputSink *sink, const Sample *sa) {
+    SummarySink *summary = (SummarySink *)sink;
+    double time = sa->row[0];
+    double dt = time - summary->tLast;
+    int i;
+    for (i = 0; i < summary->nReducers; i++) {
+        Reducer *r = &summary->reducers[i];
+        double v = sa->row[r->column];
+        if (summary->nRows == 0) {
+            r->min = r->max = v;
+            r->timeOfMin = r->timeOfMax = time;
+        } else {
+            if (v < r->min) {
+                r->min = v;
+                r->timeOfMin = time;
+            }
+            if (v > r->max) {
+                r->max = v;
+                r->timeOfMax = time;
+            }
+            if (dt > 0) {
+                addToSum(&r->integral, 0.5 * dt * (r->last + v));
+                addToSum(&r->integralOfSquare, 0.5 * dt * (r->last * r->last + v * v));
+            }
+        }
+        r->last = v;
+    }
+    if (summary->nRows == 0) summary->tStart = time;
+    summary->tLast = time;
+    summary->nRows++;
+}
+
+static int summaryEnd(OutputSink *sink) {
+    SummarySink *summary = (SummarySink *)sink;
+    ResultStream *file = summary->csv.file;
+    char separator = summary->csv.separator;
+    double duration = summary->tLast - summary->tStart;
+    int i;
+    resultStreamPrintf(file, "name%cfinal%cmin%cmax%ctimeOfMin%ctimeOfMax%cintegral%cmean%crms\n",
+            separator, separator, separator, separator, separator, separator, separator, separator);
+    for (i = 0; summary->nRows > 0 && i < summary->nReducers; i++) {
+        Reducer *r = &summary->reducers[i];
+        double integral = getSum(&r->integral);
+        double values[8];
+        int j;
+        values[0] = r->last;
+        values[1] = r->min;
+        values[2] = r->max;
+        values[3] = r->timeOfMin;
+        values[4] = r->timeOfMax;
+        values[5] = integral;
+        // a single point in time has the value as mean and |value| as RMS
+        values[6] = duration > 0 ? integral / duration : r->last;
+        values[7] = duration > 0 ? sqrt(getSum(&r->integralOfSquare) / duration) : fabs(r->last);
+        resultStreamPrintf(file, "%s", r->name);
+        for (j = 0; j < 8; j++) {
+            resultStreamPrintf(file, "%c", separator);
+            outputReal(file, separator, values[j]);
+        }
+        resultStreamPrintf(file, "\n");
+    }
+    free(summary->reducers);
+    return csvEnd(sink);
+}
+
+static OutputSink *summaryCreate(const char *argument, char separator, const OutputOptions *options) {
+    SummarySink *summary;
+    ResultStream *file = openResultFile(resultFileName(argument, SUMMARY_FILE, options), options);
+    if (!file) return NULL;
+    summary = (SummarySink *)allocate(1, sizeof(SummarySink));
+    summary->csv.sink.begin = summaryBegin;
+    summary->csv.sink.row = summaryRow;
+    summary->csv.sink.end = summaryEnd;
+    summary->csv.file = file;
+    summary->csv.separator = separator;
+    summary->options = options;
+    return &summary->csv.sink;
+}
+
+// ---------------------------------------------------------------------------
+// Output
+// ---------------------------------------------------------------------------
+
+static const struct {
+    const char *type;
+    SinkFactory create;
+    const char *defaultFile;  // name of the result file, NULL if the sink writes no file
+} sinkTypes[] = {
+    {"csv",     csvCreate,     RESULT_FILE},
+    {"changes", changesCreate, RESULT_FILE},
+    {"binary",  binaryCreate,  RESULT_FILE_BINARY},
+    {"shm",     shmCreate,     NULL},
+    {"summary", summaryCreate, SUMMARY_FILE}
+};
+
+#define N_SINK_TYPES (sizeof(sinkTypes) / sizeof(sinkTypes[0]))
+
+// index of the type of the given spec in sinkTypes, or -1. Sets argument to the text
+// following the first ':', or to NULL.
+static int findSinkType(const char *spec, const char **argument) {
+    const char *colon = strchr(spec, ':');
+    size_t length = colon ? (size_t)(colon - spec) : strlen(spec);
+    int i;
+    *argument = colon ? colon + 1 : NULL;
+    for (i = 0; i < (int)N_SINK_TYPES; i++) {
+        if (strlen(sinkTypes[i].type) == length && !strncmp(sinkTypes[i].type, spec, length)) return i;
+    }
+    return -1;
+}
+
+int isOutputSink(const char *spec) {
+    const char *argument;
+    return findSinkType(spec, &argument) >= 0;
+}
+
+// the sinks given by the options: the sinks given with -o, or else the sink of the
+// encoding. The telemetry segment given with -m is added. Returns the number of sinks.
+static int getSinks(const OutputOptions *options, const char *specs[]) {
+    static char telemetry[BUFSIZE];
+    int n = 0;
+    int i;
+    if (options->nSinks > 0) {
+        for (i = 0; i < options->nSinks; i++) specs[n++] = options->sinks[i];
+    } else {
+        switch (options->encoding) {
+            case encodingChanges: specs[n++] = "changes"; break;
+            case encodingBinary:  specs[n++] = "binary"; break;
+            default:              specs[n++] = "csv"; break;
+        }
+    }
+    if (options->telemetry) {
+        snprintf(telemetry, sizeof(telemetry), "shm:%s", options->telemetry);
+        specs[n++] = telemetry;
+    }
+    return n;
+}
+
+void printOutputFiles(const OutputOptions *options) {
+    const char *specs[MAX_OUTPUT_SINKS + 1];
+    int n = getSinks(options, specs);
+    int i;
+    for (i = 0; i < n; i++) {
+        const char *argument;
+        int type = findSinkType(specs[i], &argument);
+        if (sinkTypes[type].defaultFile) {
+            printf("Result file '%s' written\n", resultFileName(argument, sinkTypes[type].defaultFile, options));
+        }
+    }
+}
+
+// end the first n sinks, Returns 0 to indicate failure of any of them.
+static int endSinks(OutputSink **sinks, int n) {
+    int ok = 1;
+    int i;
+    for (i = 0; i < n; i++) {
+        if (!sinks[i]->end(sinks[i])) ok = 0;
+    }
+    return ok;
+}
+
+Output *openOutput(FMU *fmu, char separator, const OutputOptions *options) {
+    const char *specs[MAX_OUTPUT_SINKS + 1];
+    char files[MAX_OUTPUT_SINKS + 1][BUFSIZE];
+    int n = getSinks(options, specs);
+    Output *output = (Output *)allocate(1, sizeof(Output));
+    int i, j;
+
+    output->fmu = fmu;
+    for (i = 0; i < n; i++) {
+        const char *argument;
+        int type = findSinkType(specs[i], &argument);
+        files[i][0] = '\0';
+        if (sinkTypes[type].defaultFile) {
+            strcpy(files[i], resultFileName(argument, sinkTypes[type].defaultFile, options));
+            for (j = 0; j < i; j++) {
+                if (!strcmp(files[i], files[j])) {
+                    printf("error: The sinks %s and %s write the same file %s\n", specs[j], specs[i], files[i]);
+                    endSinks(output->sinks, output->nSinks);
+                    free(output);
+                    return NULL;
+                }
+            }
+        }
+        output->sinks[output->nSinks] = sinkTypes[type].create(argument, separator, options);
+        if (!output->sinks[output->nSinks]) {
+            endSinks(output->sinks, output->nSinks);
+            free(output);
+            return NULL;
+        }
+        output->nSinks++;
+    }
+
+    initSample(&output->sample, fmu->modelDescription);
+    for (i = 0; i < output->nSinks; i++) {
+        if (!output->sinks[i]->begin(output->sinks[i], fmu, &output->sample)) {
+            closeOutput(output);
+            return NULL;
+        }
+    }
+    return output;
+}
+
+void outputStep(Output *output, fmi2Component c, double time) {
+    int i;
+    fetchSample(&output->sample, output->fmu, c, time);
+    for (i = 0; i < output->nSinks; i++) {
+        output->sinks[i]->row(output->sinks[i], &output->sample);
+    }
+}
+
+void outputEvent(Output *output, double time, OutputEvent kinds) {
+    int i;
+    for (i = 0; i < output->nSinks; i++) {
+        if (output->sinks[i]->event) output->sinks[i]->event(output->sinks[i], time, kinds);
+    }
+}
+
+int closeOutput(Output *output) {
+    int ok = endSinks(output->sinks, output->nSinks);
+    freeSample(&output->sample);
+    free(output);
+    return ok;
+}
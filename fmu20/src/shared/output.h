@@ -0,0 +1,102 @@
+/* -------------------------------------------------------------------------
+ * output.h
+ * Output of the simulation results of fmusim_me and fmusim_cs.
+ * The values of all variables are fetched once per output step into a
+ * Sample, which is passed to any number of output sinks, e.g. a CSV file,
+ * a binary file and a shared memory segment. A sink implements the
+ * functions of OutputSink and is registered in sinkTypes in output.c.
+ * Copyright QTronic GmbH. All rights reserved.
+ * -------------------------------------------------------------------------*/
+
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include "fmi2.h"
+#include "result_stream.h"
+#include "telemetry.h"
+
+#define RESULT_FILE "result.csv"
+#define RESULT_FILE_BINARY "result.bin"
+#define SUMMARY_FILE "summary.csv"
+#define COMPRESSED_SUFFIX ".gz"
+
+// maximum number of sinks given with option -o
+#define MAX_OUTPUT_SINKS 16
+
+// encodings of the result file, see option -e in printHelp()
+typedef enum {
+    encodingRows,     // one row per output step with the values of all variables
+    encodingChanges,  // one row "time,name,value" per variable whose value changed
+    encodingBinary    // one row of doubles per output step, see binarySink in output.c
+} ResultEncoding;
+
+// options of the output, given on the command line
+typedef struct {
+    ResultEncoding encoding;  // encoding of the result file if no sink is given
+    double deadband;          // changes sink: Real values that changed less are not written
+    int compression;          // 0 for none, 1..9 for gzip compression level of result files
+    RowTransform transform;   // binary sink: transform of the rows before compression
+    const char *telemetry;    // name of the shared memory segment for live telemetry, or NULL
+    int nSinks;               // number of sinks given as <type>[:<argument>]
+    const char *sinks[MAX_OUTPUT_SINKS];
+    int nSummaryVariables;    // summary sink: number of variables to reduce, 0 for all but Strings
+    const char **summaryVariables; // summary sink: names of the variables to reduce
+} OutputOptions;
+
+// values of all scalar variables at one output step. The values are fetched once per
+// step, with one fmi2Get call per base type.
+typedef struct {
+    int n;                       // number of scalar variables
+    Elm *types;                  // base type of each variable
+    int *index;                  // of each variable: column in row, index in strings, or -1
+    int nColumns;                // 1 + number of Real, Integer, Enumeration and Boolean variables
+    double *row;                 // time followed by the values of these variables
+    int nStrings;                // number of String variables
+    fmi2String *strings;         // values of the String variables
+    int nReals;                  // number of Real variables
+    int nIntegers;               // number of Integer and Enumeration variables
+    int nBooleans;               // number of Boolean variables
+    fmi2ValueReference *vrs;     // value references of the Reals, Integers, Booleans and Strings
+    int *columns;                // column in row of the Reals, Integers and Booleans
+    fmi2Real *reals;
+    fmi2Integer *integers;
+    fmi2Boolean *booleans;
+} Sample;
+
+// kinds of events passed to OutputSink.event, may be combined
+typedef enum {
+    eventTime  = 1,
+    eventState = 2,
+    eventStep  = 4
+} OutputEvent;
+
+typedef struct OutputSink OutputSink;
+struct OutputSink {
+    // write the header, called once before the first row. Returns 0 to indicate failure.
+    int (*begin)(OutputSink *sink, FMU *fmu, const Sample *sample);
+    // write the values of one output step. The sample must not be modified.
+    void (*row)(OutputSink *sink, const Sample *sample);
+    // an event of the given kinds has been handled at the given time, optional
+    void (*event)(OutputSink *sink, double time, OutputEvent kinds);
+    // write pending data and free the sink. Returns 0 to indicate failure.
+    int (*end)(OutputSink *sink);
+};
+
+typedef struct Output Output;
+
+// Returns 1 if spec is of the form <type>[:<argument>] with a known sink type, 0 otherwise.
+int isOutputSink(const char *spec);
+// print the names of the result files written for the options
+void printOutputFiles(const OutputOptions *options);
+// create the sinks given by the options and write their headers. Returns NULL to indicate failure.
+Output *openOutput(FMU *fmu, char separator, const OutputOptions *options);
+// fetch the values of all variables from the instance and pass them to all sinks
+void outputStep(Output *output, fmi2Component c, double time);
+// pass an event to all sinks
+void outputEvent(Output *output, double time, OutputEvent kinds);
+// end all sinks and free the output. Must also be called when the simulation fails, a sink
+// completes its file, unlinks its shared memory or prints its summary only here, and the
+// sinks after a failing one are still ended. Returns 0 to indicate failure.
+int closeOutput(Output *output);
+
+#endif // OUTPUT_H
@@ -0,0 +1,152 @@
+/*
+ * Copyright QTronic GmbH. All rights reserved.
+ */
+
+/* ---------------------------------------------------------------------------*
+ * XmlArena.h
+ * Arena for the elements, attribute values and lists of a parsed model
+ * description. Memory is taken from large blocks, which are all released
+ * at once when the arena is deleted. The destructors of the objects in the
+ * arena are not called. ArenaAllocator lets a std::vector take its buffer
+ * from an arena; a buffer left behind when the vector grows is released
+ * with the arena. An arena can also be cleared and used again, as done for
+ * the transient elements of XmlParser::stream.
+ * ---------------------------------------------------------------------------*/
+
+#ifndef XML_ARENA_H
+#define XML_ARENA_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+class Arena {
+ private:
+    struct Block {
+        Block *next;
+    };
+    // alignment of the allocated memory, enough for pointers and doubles
+    static const size_t ALIGN = 8;
+    // size of the block header, rounded to ALIGN
+    static const size_t HEADER = (sizeof(Block) + ALIGN - 1) & ~(ALIGN - 1);
+    static const size_t BLOCK_SIZE = 64 * 1024;
+
+    Block *blocks;  // list of all blocks
+    char *next;     // free memory in the current block
+    char *end;      // end of the current block
+    size_t bytes;   // in all blocks, headers included
+
+    Arena(const Arena &);
+    Arena &operator=(const Arena &);
+
+    // Returns a new block of size bytes. Throws std::bad_alloc if out of memory.
+    void *allocateBlock(size_t size) {
+        Block *b = (Block *)malloc(HEADER + size);
+        if (!b) throw std::bad_alloc();
+        b->next = blocks;
+        blocks = b;
+        bytes += HEADER + size;
+        return (char *)b + HEADER;
+    }
+
+ public:
+    Arena() : blocks(NULL), next(NULL), end(NULL), bytes(0) {}
+    ~Arena() {
+        while (blocks) {
+            Block *b = blocks;
+            blocks = b->next;
+            free(b);
+        }
+    }
+    // Returns size bytes aligned to ALIGN. Throws std::bad_alloc if out of memory.
+    void *allocate(size_t size) {
+        size = (size + ALIGN - 1) & ~(ALIGN - 1);
+        if (size > (size_t)(end - next)) {
+            // a large request gets a block of its own, the current block is kept
+            if (size > BLOCK_SIZE / 4) return allocateBlock(size);
+            next = (char *)allocateBlock(BLOCK_SIZE);
+            end = next + BLOCK_SIZE;
+        }
+        void *p = next;
+        next += size;
+        return p;
+    }
+    // Take over the blocks of other, which is left empty. Used to collect the arenas
+    // of worker threads; other may still allocate, but its new blocks are its own.
+    void adopt(Arena *other) {
+        Block **last = &other->blocks;
+        if (!*last) return;
+        while (*last) last = &(*last)->next;
+        *last = blocks;
+        blocks = other->blocks;
+        bytes += other->bytes;
+        other->blocks = NULL;
+        other->next = other->end = NULL;
+        other->bytes = 0;
+    }
+    // Release all memory allocated so far, keeping the current block for reuse.
+    // The objects in the arena must no longer be used.
+    void clear() {
+        Block *current = NULL;
+        while (blocks) {
+            Block *b = blocks;
+            blocks = b->next;
+            if (!current && end && (char *)b + HEADER + BLOCK_SIZE == end) current = b;
+            else free(b);
+        }
+        if (current) {
+            current->next = NULL;
+            blocks = current;
+            next = (char *)current + HEADER;
+            bytes = HEADER + BLOCK_SIZE;
+        } else {
+            next = end = NULL;
+            bytes = 0;
+        }
+    }
+    // number of bytes taken from the heap
+    size_t size() const { return bytes; }
+    // Returns a copy of s. Throws std::bad_alloc if out of memory.
+    char *strdup(const char *s) {
+        size_t n = strlen(s) + 1;
+        char *p = (char *)allocate(n);
+        memcpy(p, s, n);
+        return p;
+    }
+};
+
+// allocator for std::vector that takes memory from an arena and never releases it
+template <typename T> class ArenaAllocator {
+ public:
+    typedef T value_type;
+    typedef T *pointer;
+    typedef const T *const_pointer;
+    typedef T &reference;
+    typedef const T &const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+    template <typename U> struct rebind {
+        typedef ArenaAllocator<U> other;
+    };
+
+    Arena *arena;
+
+    explicit ArenaAllocator(Arena *arena) : arena(arena) {}
+    template <typename U> ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+    pointer address(reference x) const { return &x; }
+    const_pointer address(const_reference x) const { return &x; }
+    pointer allocate(size_type n, const void * = 0) { return (pointer)arena->allocate(n * sizeof(T)); }
+    void deallocate(pointer, size_type) {}  // released with the arena
+    size_type max_size() const { return ((size_t)-1) / sizeof(T); }
+    void construct(pointer p, const T &value) { new ((void *)p) T(value); }
+    void destroy(pointer p) { p->~T(); }
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) { return a.arena == b.arena; }
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) { return a.arena != b.arena; }
+
+#endif  // XML_ARENA_H
@@ -0,0 +1,494 @@
+/*
+ * Copyright QTronic GmbH. All rights reserved.
+ */
+
+/* ---------------------------------------------------------------------------*
+ * XmlCache.cpp
+ * Binary cache of a parsed model description, see XmlCache.h.
+ * ---------------------------------------------------------------------------*/
+
+#include "XmlCache.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "XmlElement.h"
+
+#ifdef _MSC_VER
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() {
+#ifdef _MSC_VER
+    file = INVALID_HANDLE_VALUE;
+    mapping = NULL;
+#endif
+    data = NULL;
+    size = 0;
+}
+
+#ifdef _MSC_VER
+MappedFile *MappedFile::open(const char *path) {
+    MappedFile *m = new MappedFile;
+    LARGE_INTEGER size;
+    m->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (m->file != INVALID_HANDLE_VALUE && GetFileSizeEx(m->file, &size) && size.QuadPart > 0) {
+        m->size = (size_t)size.QuadPart;
+        m->mapping = CreateFileMappingA(m->file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+        if (m->mapping) m->data = (char *)MapViewOfFile(m->mapping, FILE_MAP_COPY, 0, 0, 0);
+    }
+    if (!m->data) {
+        delete m;
+        return NULL;
+    }
+    return m;
+}
+
+MappedFile::~MappedFile() {
+    if (data) UnmapViewOfFile(data);
+    if (mapping) CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+}
+#else
+MappedFile *MappedFile::open(const char *path) {
+    struct stat st;
+    void *data;
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return NULL;
+    MappedFile *m = new MappedFile;
+    m->data = (char *)data;
+    m->size = (size_t)st.st_size;
+    return m;
+}
+
+MappedFile::~MappedFile() {
+    if (data) munmap(data, size);
+}
+#endif
+
+static const unsigned int BYTE_ORDER_MARK = 0x01020304;
+
+// FNV-1a, 64 bit
+static unsigned long long hashBytes(const char *p, size_t n) {
+    unsigned long long h = 14695981039346656037ULL;
+    for (size_t i = 0; i < n; i++) h = (h ^ (unsigned char)p[i]) * 1099511628211ULL;
+    return h;
+}
+
+// hash of the content of a file, FNV-1a over 8 byte words with the high bits folded
+// into the low bits after each word
+static unsigned long long hashFile(const char *p, size_t n) {
+    unsigned long long h = 14695981039346656037ULL ^ n;
+    size_t i;
+    for (i = 0; i + 8 <= n; i += 8) {
+        unsigned long long w;
+        memcpy(&w, p + i, 8);
+        h = (h ^ w) * 1099511628211ULL;
+        h ^= h >> 32;
+    }
+    return h ^ hashBytes(p + i, n - i);
+}
+
+// number of bits set in x
+static int countBits(unsigned long long x) {
+    int n = 0;
+    for (; x; x &= x - 1) n++;
+    return n;
+}
+
+// ---------------------------------------------------------------------------
+// Writing
+
+// collects the elements, attribute values and strings of a model description
+class CacheWriter {
+ private:
+    // index of the strings by content, open addressing with linear probing.
+    // Slots hold the offset of the string + 1, 0 for an empty slot.
+    std::vector<unsigned int> slots;
+    unsigned int nStrings;
+
+    unsigned int addString(const char *s) {
+        if (2 * (nStrings + 1) > slots.size()) {
+            std::vector<unsigned int> old;
+            old.swap(slots);
+            slots.assign(old.empty() ? 1024 : 2 * old.size(), 0);
+            for (size_t i = 0; i < old.size(); i++) {
+                if (old[i]) insertSlot(old[i]);
+            }
+        }
+        size_t n = strlen(s);
+        size_t mask = slots.size() - 1;
+        size_t h;
+        for (h = hashBytes(s, n) & mask; slots[h]; h = (h + 1) & mask) {
+            if (!strcmp(&strings[slots[h] - 1], s)) return slots[h] - 1;
+        }
+        unsigned int offset = (unsigned int)strings.size();
+        strings.insert(strings.end(), s, s + n + 1);
+        slots[h] = offset + 1;
+        nStrings++;
+        return offset;
+    }
+    void insertSlot(unsigned int slot) {
+        const char *s = &strings[slot - 1];
+        size_t mask = slots.size() - 1;
+        size_t h;
+        for (h = hashBytes(s, strlen(s)) & mask; slots[h]; h = (h + 1) & mask);
+        slots[h] = slot;
+    }
+
+ public:
+    std::vector<CacheElement> elements;
+    std::vector<TypedValue> typedValues;
+    std::vector<unsigned int> values;
+    std::vector<char> strings;
+
+    CacheWriter() : nStrings(0) {}
+
+    // add an element and its attributes. Returns the index of the element.
+    int add(Element *e, CacheKind kind, int parent, XmlParser::Elm list = XmlParser::elm_BAD_DEFINED) {
+        CacheElement c;
+        int n = e->getAttributeCount();
+        c.attributeMask = e->attributeMask;
+        c.firstValue = (unsigned int)values.size();
+        c.firstTypedValue = (unsigned int)typedValues.size();
+        c.type = e->type;
+        c.parent = parent;
+        c.kind = (short)kind;
+        c.list = (short)list;
+        for (int i = 0; i < n; i++) values.push_back(addString(e->attributeValues[i]));
+        n = countBits(e->attributeMask & Element::TYPED_ATTRIBUTES);
+        if (n > 0) typedValues.insert(typedValues.end(), e->typedValues(), e->typedValues() + n);
+        elements.push_back(c);
+        return (int)elements.size() - 1;
+    }
+    template <typename L> void addList(const L &list, CacheKind kind, int parent,
+                                       XmlParser::Elm listType = XmlParser::elm_BAD_DEFINED) {
+        for (typename L::const_iterator it = list.begin(); it != list.end(); ++it) {
+            add(*it, kind, parent, listType);
+        }
+    }
+};
+
+static void addComponent(CacheWriter *w, Component *c, int parent) {
+    if (!c) return;
+    int i = w->add(c, kindComponent, parent);
+    w->addList(c->files, kindElement, i);
+}
+
+static void addModelDescription(CacheWriter *w, ModelDescription *md) {
+    int root = w->add(md, kindModelDescription, -1);
+    addComponent(w, md->modelExchange, root);
+    addComponent(w, md->coSimulation, root);
+    for (size_t k = 0; k < md->unitDefinitions.size(); k++) {
+        Unit *u = md->unitDefinitions[k];
+        int i = w->add(u, kindUnit, root);
+        if (u->baseUnit) w->add(u->baseUnit, kindElement, i);
+        w->addList(u->displayUnits, kindElement, i);
+    }
+    for (size_t k = 0; k < md->typeDefinitions.size(); k++) {
+        SimpleType *t = md->typeDefinitions[k];
+        int i = w->add(t, kindSimpleType, root);
+        if (!t->typeSpec) continue;
+        if (t->typeSpec->type == XmlParser::elm_Enumeration) {
+            ListElement *e = (ListElement *)t->typeSpec;
+            w->addList(e->list, kindElement, w->add(e, kindListElement, i));
+        } else {
+            w->add(t->typeSpec, kindElement, i);
+        }
+    }
+    w->addList(md->logCategories, kindElement, root);
+    if (md->defaultExperiment) w->add(md->defaultExperiment, kindElement, root);
+    w->addList(md->vendorAnnotations, kindElement, root);
+    for (size_t k = 0; k < md->modelVariables.size(); k++) {
+        ScalarVariable *sv = md->modelVariables[k];
+        int i = w->add(sv, kindScalarVariable, root);
+        if (sv->typeSpec) w->add(sv->typeSpec, kindElement, i);
+        if (sv->annotations) w->addList(*sv->annotations, kindElement, i);
+    }
+    if (md->modelStructure) {
+        ModelStructure *ms = md->modelStructure;
+        int i = w->add(ms, kindModelStructure, root);
+        w->addList(ms->outputs, kindElement, i, XmlParser::elm_Outputs);
+        w->addList(ms->derivatives, kindElement, i, XmlParser::elm_Derivatives);
+        w->addList(ms->discreteStates, kindElement, i, XmlParser::elm_DiscreteStates);
+        w->addList(ms->initialUnknowns, kindElement, i, XmlParser::elm_InitialUnknowns);
+    }
+}
+
+#ifdef _MSC_VER
+static volatile LONG tmpFiles = 0;  // created by this process, for unique names
+#endif
+
+// Create a temporary file next to path, its name unique among concurrent writers, and
+// set *tmpPath to its name, to be freed by the caller. Returns NULL to indicate failure.
+static FILE *createTmpFile(const char *path, char **tmpPath) {
+    FILE *file;
+    *tmpPath = (char *)malloc(strlen(path) + 32);
+    if (!*tmpPath) return NULL;
+#ifdef _MSC_VER
+    sprintf(*tmpPath, "%s.%lu.%ld.tmp", path, GetCurrentProcessId(), InterlockedIncrement(&tmpFiles));
+    file = fopen(*tmpPath, "wb");
+#else
+    int fd;
+    sprintf(*tmpPath, "%s.XXXXXX", path);
+    fd = mkstemp(*tmpPath);
+    if (fd == -1) {
+        file = NULL;
+    } else {
+        // mkstemp creates the file readable by the owner only
+        fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+        file = fdopen(fd, "wb");
+        if (!file) {
+            close(fd);
+            remove(*tmpPath);
+        }
+    }
+#endif
+    if (!file) {
+        free(*tmpPath);
+        *tmpPath = NULL;
+    }
+    return file;
+}
+
+void writeModelDescriptionCache(ModelDescription *md, const char *cachePath, unsigned long long xmlHash) {
+    CacheWriter w;
+    CacheHeader h;
+    char *tmpPath;
+    FILE *file;
+    bool ok;
+    try {
+        addModelDescription(&w, md);
+    } catch (std::bad_alloc &) {
+        return;
+    }
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, XML_CACHE_MAGIC, sizeof(h.magic));
+    h.version = XML_CACHE_VERSION;
+    h.byteOrder = BYTE_ORDER_MARK;
+    h.xmlHash = xmlHash;
+    h.nElements = (unsigned int)w.elements.size();
+    h.nTypedValues = (unsigned int)w.typedValues.size();
+    h.nValues = (unsigned int)w.values.size();
+    h.stringsSize = (unsigned int)w.strings.size();
+
+    // write to a temporary file of its own that replaces the cache when complete, so that
+    // a concurrent reader never sees a partial cache, also with several writers
+    file = createTmpFile(cachePath, &tmpPath);
+    if (file) {
+        ok = fwrite(&h, sizeof(h), 1, file) == 1
+            && fwrite(&w.elements[0], sizeof(CacheElement), h.nElements, file) == h.nElements
+            && (h.nTypedValues == 0
+                || fwrite(&w.typedValues[0], sizeof(TypedValue), h.nTypedValues, file) == h.nTypedValues)
+            && (h.nValues == 0 || fwrite(&w.values[0], sizeof(unsigned int), h.nValues, file) == h.nValues)
+            && (h.stringsSize == 0 || fwrite(&w.strings[0], 1, h.stringsSize, file) == h.stringsSize);
+        ok = fclose(file) == 0 && ok;
+#ifdef _MSC_VER
+        ok = ok && MoveFileExA(tmpPath, cachePath, MOVEFILE_REPLACE_EXISTING);
+#else
+        ok = ok && rename(tmpPath, cachePath) == 0;
+#endif
+        if (!ok) remove(tmpPath);
+    }
+    free(tmpPath);
+}
+
+// ---------------------------------------------------------------------------
+// Loading
+
+template <typename T> static T *create(Arena *arena, XmlParser::Elm type) {
+    T *element = new (arena->allocate(sizeof(T))) T(arena);
+    element->type = type;
+    return element;
+}
+
+// add child to its parent as handleElement of the parent does, a list created on demand
+// in arena. Returns false if the child does not belong into the parent.
+static bool attach(Arena *arena, Element *parent, CacheKind parentKind, Element *child, const CacheElement *c) {
+    switch (parentKind) {
+        case kindModelDescription: {
+            ModelDescription *md = (ModelDescription *)parent;
+            switch (c->type) {
+                case XmlParser::elm_ModelExchange: md->modelExchange = (Component *)child; return c->kind == kindComponent;
+                case XmlParser::elm_CoSimulation: md->coSimulation = (Component *)child; return c->kind == kindComponent;
+                case XmlParser::elm_Unit: md->unitDefinitions.push_back((Unit *)child); return c->kind == kindUnit;
+                case XmlParser::elm_SimpleType: md->typeDefinitions.push_back((SimpleType *)child); return c->kind == kindSimpleType;
+                case XmlParser::elm_Category: md->logCategories.push_back(child); return true;
+                case XmlParser::elm_DefaultExperiment: md->defaultExperiment = child; return true;
+                case XmlParser::elm_Tool: md->vendorAnnotations.push_back(child); return true;
+                case XmlParser::elm_ScalarVariable:
+                    md->modelVariables.push_back((ScalarVariable *)child);
+                    return c->kind == kindScalarVariable;
+                case XmlParser::elm_ModelStructure:
+                    md->modelStructure = (ModelStructure *)child;
+                    return c->kind == kindModelStructure;
+                default: return false;
+            }
+        }
+        case kindUnit: {
+            Unit *u = (Unit *)parent;
+            if (c->type == XmlParser::elm_BaseUnit) u->baseUnit = child;
+            else if (c->type == XmlParser::elm_DisplayUnit) u->displayUnits.push_back(child);
+            else return false;
+            return true;
+        }
+        case kindSimpleType:
+            ((SimpleType *)parent)->typeSpec = child;
+            return true;
+        case kindComponent:
+            ((Component *)parent)->files.push_back(child);
+            return true;
+        case kindScalarVariable: {
+            ScalarVariable *sv = (ScalarVariable *)parent;
+            if (c->type == XmlParser::elm_Tool) {
+                if (!sv->annotations) {
+                    sv->annotations = new (arena->allocate(sizeof(ElementList)))
+                        ElementList(ElementList::allocator_type(arena));
+                }
+                sv->annotations->push_back(child);
+            } else {
+                sv->typeSpec = child;
+            }
+            return true;
+        }
+        case kindListElement:
+            ((ListElement *)parent)->list.push_back(child);
+            return true;
+        case kindModelStructure: {
+            ModelStructure *ms = (ModelStructure *)parent;
+            switch (c->list) {
+                case XmlParser::elm_Outputs: ms->outputs.push_back(child); return true;
+                case XmlParser::elm_Derivatives: ms->derivatives.push_back(child); return true;
+                case XmlParser::elm_DiscreteStates: ms->discreteStates.push_back(child); return true;
+                case XmlParser::elm_InitialUnknowns: ms->initialUnknowns.push_back(child); return true;
+                default: return false;
+            }
+        }
+        default:
+            return false;
+    }
+}
+
+static Element *createElement(Arena *arena, const CacheElement *c) {
+    XmlParser::Elm type = (XmlParser::Elm)c->type;
+    switch (c->kind) {
+        case kindElement: return create<Element>(arena, type);
+        case kindListElement: return create<ListElement>(arena, type);
+        case kindUnit: return create<Unit>(arena, type);
+        case kindSimpleType: return create<SimpleType>(arena, type);
+        case kindComponent: return create<Component>(arena, type);
+        case kindScalarVariable: return create<ScalarVariable>(arena, type);
+        case kindModelStructure: return create<ModelStructure>(arena, type);
+        default: return NULL;
+    }
+}
+
+// create the elements of the mapped cache in a new arena. Returns NULL if the cache is invalid.
+static ModelDescription *loadElements(MappedFile *cache) {
+    const CacheHeader *h = (const CacheHeader *)cache->data;
+    const CacheElement *elements = (const CacheElement *)(cache->data + sizeof(CacheHeader));
+    TypedValue *typedValues = (TypedValue *)(elements + h->nElements);
+    const unsigned int *values = (const unsigned int *)(typedValues + h->nTypedValues);
+    char *strings = (char *)(values + h->nValues);
+    Arena *arena = NULL;
+    ModelDescription *md = NULL;
+    try {
+        std::vector<Element *> created(h->nElements);
+        arena = new Arena;
+        for (unsigned int i = 0; i < h->nElements; i++) {
+            const CacheElement *c = &elements[i];
+            Element *e;
+            int n;
+            int nTyped;
+            if (c->type < 0 || c->type >= XmlParser::SIZEOF_ELM) break;
+            if (i == 0) {
+                if (c->kind != kindModelDescription || c->parent != -1) break;
+                e = md = create<ModelDescription>(arena, (XmlParser::Elm)c->type);
+            } else {
+                if (c->parent < 0 || (unsigned int)c->parent >= i) break;
+                e = createElement(arena, c);
+                if (!e || !attach(arena, created[c->parent], (CacheKind)elements[c->parent].kind, e, c)) break;
+            }
+            e->attributeMask = c->attributeMask;
+            n = e->getAttributeCount();
+            if (c->firstValue > h->nValues || (unsigned int)n > h->nValues - c->firstValue) break;
+            nTyped = countBits(c->attributeMask & Element::TYPED_ATTRIBUTES);
+            if (c->firstTypedValue > h->nTypedValues
+                    || (unsigned int)nTyped > h->nTypedValues - c->firstTypedValue) break;
+            if (n > 0) {
+                e->attributeValues = (char **)arena->allocate(Element::valuesSize(c->attributeMask));
+                if (nTyped > 0) {
+                    memcpy(e->typedValues(), typedValues + c->firstTypedValue, nTyped * sizeof(TypedValue));
+                }
+                for (int k = 0; k < n; k++) {
+                    unsigned int offset = values[c->firstValue + k];
+                    if (offset >= h->stringsSize) {
+                        n = -1;
+                        break;
+                    }
+                    e->attributeValues[k] = strings + offset;
+                }
+                if (n < 0) break;
+            }
+            created[i] = e;
+        }
+        if (!md || !created[h->nElements - 1]) {
+            delete arena;
+            return NULL;
+        }
+        md->buildIndexes();
+        if (md->modelStructure) md->modelStructure->buildDependencies(arena);
+    } catch (std::bad_alloc &) {
+        delete arena;
+        return NULL;
+    }
+    return md;
+}
+
+ModelDescription *loadModelDescriptionCache(const char *xmlPath, const char *cachePath,
+                                            unsigned long long *xmlHash) {
+    MappedFile *xml = MappedFile::open(xmlPath);
+    MappedFile *cache;
+    const CacheHeader *h;
+    ModelDescription *md;
+    if (!xml) return NULL;
+    *xmlHash = hashFile(xml->data, xml->size);
+    delete xml;
+
+    cache = MappedFile::open(cachePath);
+    if (!cache) return NULL;
+    h = (const CacheHeader *)cache->data;
+    if (cache->size < sizeof(CacheHeader)
+        || memcmp(h->magic, XML_CACHE_MAGIC, sizeof(h->magic))
+        || h->version != XML_CACHE_VERSION
+        || h->byteOrder != BYTE_ORDER_MARK
+        || h->xmlHash != *xmlHash
+        || h->nElements == 0
+        || h->stringsSize == 0
+        || cache->size != sizeof(CacheHeader) + (unsigned long long)h->nElements * sizeof(CacheElement)
+                          + (unsigned long long)h->nTypedValues * sizeof(TypedValue)
+                          + (unsigned long long)h->nValues * sizeof(unsigned int) + h->stringsSize
+        || cache->data[cache->size - 1] != '\0') {
+        delete cache;
+        return NULL;
+    }
+    md = loadElements(cache);
+    if (!md) {
+        delete cache;
+        return NULL;
+    }
+    md->mappedFile = cache;
+    return md;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright QTronic GmbH. All rights reserved.
+ */
+
+/* ---------------------------------------------------------------------------*
+ * XmlCache.h
+ * Binary cache of a parsed model description, written by parseCached to a
+ * file given by the caller. The cache holds the hash of the xml file it was made
+ * from and is used instead of parsing the xml file as long as the hash
+ * matches. The file is mapped into memory and contains no pointers:
+ *   CacheHeader
+ *   CacheElement[nElements]    the elements in pre-order, parents first
+ *   TypedValue[nTypedValues]   parsed numeric attribute values
+ *   unsigned int[nValues]      attribute values, offsets into the strings
+ *   char[stringsSize]          nul terminated strings, each stored once
+ * The attributes of an element are packed as in Element: attributeMask and
+ * the values from firstValue on, and the typed values from firstTypedValue
+ * on. Loading creates the elements in an arena, copies their typed values
+ * next to the attribute values, which point into the mapping, and the file
+ * stays mapped until the model description is freed. All numbers are in
+ * the byte order of the writer, a cache of another byte order is ignored.
+ * ---------------------------------------------------------------------------*/
+
+#ifndef XML_CACHE_H
+#define XML_CACHE_H
+
+#include <cstddef>
+
+class ModelDescription;
+
+// a file mapped into memory, copy on write
+class MappedFile {
+ private:
+#ifdef _MSC_VER
+    void *file;
+    void *mapping;
+#endif
+    MappedFile();
+    MappedFile(const MappedFile &);
+    MappedFile &operator=(const MappedFile &);
+
+ public:
+    char *data;
+    size_t size;
+
+    // Returns NULL to indicate failure, e.g. if the file does not exist or is empty.
+    static MappedFile *open(const char *path);
+    ~MappedFile();
+};
+
+#define XML_CACHE_MAGIC "FMUMDC\x1a\n"
+#define XML_CACHE_VERSION 2
+
+struct CacheHeader {
+    char magic[8];                // XML_CACHE_MAGIC
+    unsigned int version;         // XML_CACHE_VERSION
+    unsigned int byteOrder;       // 0x01020304 in the byte order of the writer
+    unsigned long long xmlHash;   // of the content of the xml file
+    unsigned int nElements;
+    unsigned int nTypedValues;
+    unsigned int nValues;
+    unsigned int stringsSize;
+};
+
+struct CacheElement {
+    unsigned long long attributeMask;
+    unsigned int firstValue;  // index of the value of the first attribute present
+    unsigned int firstTypedValue;  // index of the first typed value, see Element::typedValues
+    int type;                 // XmlParser::Elm
+    int parent;               // index of the parent element, -1 for fmiModelDescription
+    short kind;               // CacheKind, the class of the element
+    short list;               // XmlParser::Elm of the list of the parent holding this Unknown
+};
+
+enum CacheKind {
+    kindElement, kindListElement, kindUnit, kindSimpleType, kindComponent,
+    kindScalarVariable, kindModelStructure, kindModelDescription
+};
+
+// Returns the model description of the cache file cachePath if it was made from the current
+// content of the given xml file, NULL otherwise. Sets *xmlHash to the hash of the xml file
+// and returns NULL if the xml file cannot be read.
+ModelDescription *loadModelDescriptionCache(const char *xmlPath, const char *cachePath,
+                                            unsigned long long *xmlHash);
+// write the cache file cachePath of md, parsed from the xml file with the given hash.
+// Failures are ignored, the xml file is parsed again then.
+void writeModelDescriptionCache(ModelDescription *md, const char *cachePath, unsigned long long xmlHash);
+
+#endif  // XML_CACHE_H
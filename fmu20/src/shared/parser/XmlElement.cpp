@@ -13,11 +13,11 @@
 
 #include "XmlElement.h"
 #include <assert.h>
-#include <map>
 #include <string>
 #include <vector>
 #include "XmlParserException.h"
 
+#include <cstdlib> // strtod()
 #include <cstring> // strcmp()
 
 
@@ -28,18 +28,60 @@
 #include "logging.h"  // logThis
 #endif  // STANDALONE_XML_PARSER
 
-Element::~Element() {
-    for (std::map<XmlParser::Att, char *>::const_iterator it = attributes.begin(); it != attributes.end(); ++it) {
-        free(it->second);
-    }
-    attributes.clear();
+// number of bits set in x
+static int countBits(unsigned long long x) {
+#ifdef __GNUC__
+    return __builtin_popcountll(x);
+#else
+    int n = 0;
+    for (; x; x &= x - 1) n++;
+    return n;
+#endif
 }
-template <typename T> void Element::deleteListOfElements(const std::vector<T *> &list) {
-    typename std::vector<T*>::const_iterator it;
-    for (it = list.begin(); it != list.end(); ++it) {
-        delete *it;
+
+Element::Element(Arena *arena) {
+    type = XmlParser::elm_BAD_DEFINED;
+    attributeMask = 0;
+    attributeValues = NULL;
+}
+int Element::getAttributeCount() {
+    return countBits(attributeMask);
+}
+size_t Element::valuesSize(unsigned long long mask) {
+    return countBits(mask) * sizeof(char *) + countBits(mask & TYPED_ATTRIBUTES) * sizeof(TypedValue);
+}
+void Element::parseTypedValues() {
+    unsigned long long typed = attributeMask & TYPED_ATTRIBUTES;
+    if (!typed) return;
+    TypedValue *typedValues = this->typedValues();
+    int k = 0;
+    for (int att = 0; att < XmlParser::SIZEOF_ATT; att++) {
+        if (!(typed & (1ULL << att))) continue;
+        // same results as sscanf with %lf and %d or %u, each converts a prefix of value
+        const char *value = getAttributeValue((XmlParser::Att)att);
+        TypedValue *t = &typedValues[k++];
+        char *end;
+        t->real = 0;
+        t->integer = 0;
+        if (!value) {
+            t->realStatus = t->integerStatus = XmlParser::valueMissing;
+            continue;
+        }
+        double d = strtod(value, &end);
+        t->realStatus = end != value ? XmlParser::valueDefined : XmlParser::valueIllegal;
+        if (end != value) t->real = d;
+        unsigned long u = strtoul(value, &end, 10);
+        t->integerStatus = end != value ? XmlParser::valueDefined : XmlParser::valueIllegal;
+        if (end != value) t->integer = (int)u;
     }
 }
+const TypedValue *Element::getTypedValue(XmlParser::Att att) {
+    if (att < 0) return NULL;
+    unsigned long long bit = 1ULL << att;
+    unsigned long long typed = attributeMask & TYPED_ATTRIBUTES;
+    if (!(typed & bit)) return NULL;
+    return &typedValues()[countBits(typed & (bit - 1))];
+}
 void Element::handleElement(XmlParser *parser, const char *childName, int isEmptyElement) {
     throw XmlParserException("Elements are not expected inside '%s'. Found instead '%s'",
         XmlParser::elmNames[type],
@@ -48,25 +90,29 @@ void Element::handleElement(XmlParser *parser, const char *childName, int isEmpt
 void Element::printElement(int indent) {
     std::string indentS(indent, ' ');
     logThis(ERROR_INFO, "%s%s", indentS.c_str(), XmlParser::elmNames[type]);
-    for (std::map<XmlParser::Att, char *>::const_iterator it = attributes.begin(); it != attributes.end(); ++it) {
-        logThis(ERROR_INFO, "%s%s=%s", indentS.c_str(), XmlParser::attNames[it->first], it->second);
+    int k = 0;
+    for (int att = 0; att < XmlParser::SIZEOF_ATT; att++) {
+        if (attributeMask & (1ULL << att)) {
+            logThis(ERROR_INFO, "%s%s=%s", indentS.c_str(), XmlParser::attNames[att], attributeValues[k++]);
+        }
     }
 }
-template <typename T> void Element::printListOfElements(int indent, const std::vector<T *> &list) {
-    typename std::vector<T*>::const_iterator it;
+template <typename L> void Element::printListOfElements(int indent, const L &list) {
+    typename L::const_iterator it;
     for (it = list.begin(); it != list.end(); ++it) {
         (*it)->printElement(indent);
     }
 }
 
 const char *Element::getAttributeValue(XmlParser::Att att) {
-    std::map<XmlParser::Att, char *>::const_iterator it = attributes.find(att);
-    if (it != attributes.end()) {
-        return it->second;
-    }
-    return NULL;
+    if (att < 0) return NULL;
+    unsigned long long bit = 1ULL << att;
+    if (!(attributeMask & bit)) return NULL;
+    return attributeValues[countBits(attributeMask & (bit - 1))];
 }
 int Element::getAttributeInt(XmlParser::Att att, XmlParser::ValueStatus *vs) {
+    const TypedValue *t = getTypedValue(att);
+    if (t) { *vs = (XmlParser::ValueStatus)t->integerStatus; return t->integer; }
     int n = 0;
     const char *value = getAttributeValue(att);
     if (!value) { *vs = XmlParser::valueMissing; return n; }
@@ -74,6 +120,11 @@ int Element::getAttributeInt(XmlParser::Att att, XmlParser::ValueStatus *vs) {
     return n;
 }
 unsigned int Element::getAttributeUInt(XmlParser::Att att, XmlParser::ValueStatus *vs) {
+    const TypedValue *t = getTypedValue(att);
+    if (t) {
+        *vs = (XmlParser::ValueStatus)t->integerStatus;
+        return *vs == XmlParser::valueDefined ? (unsigned int)t->integer : (unsigned int)-1;
+    }
     unsigned int u = -1;
     const char* value = getAttributeValue(att);
     if (!value) { *vs = XmlParser::valueMissing; return u; }
@@ -81,6 +132,8 @@ unsigned int Element::getAttributeUInt(XmlParser::Att att, XmlParser::ValueStatu
     return u;
 }
 double Element::getAttributeDouble(XmlParser::Att att, XmlParser::ValueStatus *vs) {
+    const TypedValue *t = getTypedValue(att);
+    if (t) { *vs = (XmlParser::ValueStatus)t->realStatus; return t->real; }
     double d = 0;
     const char* value = getAttributeValue(att);
     if (!value) { *vs = XmlParser::valueMissing; return d; }
@@ -97,14 +150,12 @@ bool Element::getAttributeBool(XmlParser::Att att, XmlParser::ValueStatus *vs) {
     return false;
 }
 
-ListElement::~ListElement() {
-    deleteListOfElements(list);
+ListElement::ListElement(Arena *arena) : Element(arena), list(ElementList::allocator_type(arena)) {
 }
 void ListElement::handleElement(XmlParser *parser, const char *childName, int isEmptyElement) {
     XmlParser::Elm childType = parser->checkElement(childName);
     if (childType == XmlParser::elm_Item) {
-        Element *item = new Element;
-        item->type = childType;
+        Element *item = parser->newElement<Element>(childType);
         parser->parseElementAttributes(item);
         if (!isEmptyElement) {
             parser->parseEndElement();
@@ -124,25 +175,19 @@ void ListElement::printElement(int indent) {
 }
 
 
-Unit::Unit() {
+Unit::Unit(Arena *arena) : Element(arena), displayUnits(ElementList::allocator_type(arena)) {
     baseUnit = NULL;
 }
-Unit::~Unit() {
-    if (baseUnit) delete baseUnit;
-    deleteListOfElements(displayUnits);
-}
 void Unit::handleElement(XmlParser *parser, const char *childName, int isEmptyElement) {
     XmlParser::Elm childType = parser->checkElement(childName);
     if (childType == XmlParser::elm_BaseUnit) {
-        baseUnit = new Element;
-        baseUnit->type = childType;
+        baseUnit = parser->newElement<Element>(childType);
         parser->parseElementAttributes(baseUnit);
         if (!isEmptyElement) {
             parser->parseEndElement();
         }
     } else if (childType == XmlParser::elm_DisplayUnit) {
-        Element *displayUnit = new Element;
-        displayUnit->type = childType;
+        Element *displayUnit = parser->newElement<Element>(childType);
         parser->parseElementAttributes(displayUnit);
         displayUnits.push_back(displayUnit);
         if (!isEmptyElement) {
@@ -164,12 +209,9 @@ void Unit::printElement(int indent) {
 }
 
 
-SimpleType::SimpleType() {
+SimpleType::SimpleType(Arena *arena) : Element(arena) {
     typeSpec = NULL;
 }
-SimpleType::~SimpleType() {
-    if (typeSpec) delete typeSpec;
-}
 void SimpleType::handleElement(XmlParser *parser, const char *childName, int isEmptyElement) {
     XmlParser::Elm childType = parser->checkElement(childName);
     switch (childType) {
@@ -177,8 +219,7 @@ void SimpleType::handleElement(XmlParser *parser, const char *childName, int isE
         case XmlParser::elm_Integer:
         case XmlParser::elm_Boolean:
         case XmlParser::elm_String: {
-            typeSpec = new Element;
-            typeSpec->type = childType;
+            typeSpec = parser->newElement<Element>(childType);
             parser->parseElementAttributes(typeSpec);
             if (!isEmptyElement) {
                 parser->parseEndElement();
@@ -186,8 +227,7 @@ void SimpleType::handleElement(XmlParser *parser, const char *childName, int isE
             break;
         }
         case XmlParser::elm_Enumeration: {
-            typeSpec = new ListElement;
-            typeSpec->type = childType;
+            typeSpec = parser->newElement<ListElement>(childType);
             parser->parseElementAttributes(typeSpec);
             if (!isEmptyElement) {
                 parser->parseChildElements(typeSpec);
@@ -214,8 +254,7 @@ void SimpleType::printElement(int indent) {
 }
 
 
-Component::~Component() {
-    deleteListOfElements(files);
+Component::Component(Arena *arena) : Element(arena), files(ElementList::allocator_type(arena)) {
 }
 void Component::handleElement(XmlParser *parser, const char *childName, int isEmptyElement) {
     XmlParser::Elm childType = parser->checkElement(childName);
@@ -224,8 +263,7 @@ void Component::handleElement(XmlParser *parser, const char *childName, int isEm
             parser->parseChildElements(this);
         }
     } else if (childType == XmlParser::elm_File) {
-        Element *sourceFile = new Element;
-        sourceFile->type = childType;
+        Element *sourceFile = parser->newElement<Element>(childType);
         parser->parseElementAttributes(sourceFile);
         if (!isEmptyElement) {
             parser->parseEndElement();
@@ -246,12 +284,9 @@ void Component::printElement(int indent) {
 }
 
 
-ScalarVariable::ScalarVariable() {
+ScalarVariable::ScalarVariable(Arena *arena) : Element(arena) {
     typeSpec = NULL;
-}
-ScalarVariable::~ScalarVariable() {
-    delete typeSpec;
-    deleteListOfElements(annotations);
+    annotations = NULL;
 }
 void ScalarVariable::handleElement(XmlParser *parser, const char *childName, int isEmptyElement) {
     XmlParser::Elm childType = parser->checkElement(childName);
@@ -261,8 +296,7 @@ void ScalarVariable::handleElement(XmlParser *parser, const char *childName, int
         case XmlParser::elm_Boolean:
         case XmlParser::elm_String:
         case XmlParser::elm_Enumeration: {
-            typeSpec = new Element;
-            typeSpec->type = childType;
+            typeSpec = parser->newElement<Element>(childType);
             parser->parseElementAttributes(typeSpec);
             if (!isEmptyElement) {
                 parser->parseEndElement();
@@ -275,13 +309,13 @@ void ScalarVariable::handleElement(XmlParser *parser, const char *childName, int
             break;
         }
         case XmlParser::elm_Tool: {
-            Element *tool = new Element;
-            tool->type = childType;
+            Element *tool = parser->newElement<Element>(childType);
             parser->parseElementAttributes(tool);
             if (!isEmptyElement) {
                 parser->parseSkipChildElement();
             }
-            annotations.push_back(tool);
+            if (!annotations) annotations = parser->newList<ElementList>();
+            annotations->push_back(tool);
             break;
         }
         default: {
@@ -331,18 +365,17 @@ void ScalarVariable::printElement(int indent) {
     Element::printElement(indent);
     int childIndent = indent + 1;
     typeSpec->printElement(childIndent);
-    printListOfElements(childIndent, annotations);
+    if (annotations) printListOfElements(childIndent, *annotations);
 }
 
-ModelStructure::ModelStructure() {
+ModelStructure::ModelStructure(Arena *arena)
+    : Element(arena),
+      outputs(ElementList::allocator_type(arena)),
+      derivatives(ElementList::allocator_type(arena)),
+      discreteStates(ElementList::allocator_type(arena)),
+      initialUnknowns(ElementList::allocator_type(arena)) {
     unknownParentType = XmlParser::elm_BAD_DEFINED;
-}
-
-ModelStructure::~ModelStructure() {
-    deleteListOfElements(outputs);
-    deleteListOfElements(derivatives);
-    deleteListOfElements(discreteStates);
-    deleteListOfElements(initialUnknowns);
+    memset(dependencies, 0, sizeof(dependencies));
 }
 void ModelStructure::handleElement(XmlParser *parser, const char *childName, int isEmptyElement) {
     XmlParser::Elm childType = parser->checkElement(childName);
@@ -361,8 +394,7 @@ void ModelStructure::handleElement(XmlParser *parser, const char *childName, int
         }
     case XmlParser::elm_Unknown:
         {
-            Element *unknown = new Element;
-            unknown->type = childType;
+            Element *unknown = parser->newElement<Element>(childType);
             parser->parseElementAttributes(unknown);
             if (!isEmptyElement) {
                 parser->parseEndElement();
@@ -415,31 +447,143 @@ void ModelStructure::printElement(int indent) {
     printListOfElements(childIndent, initialUnknowns);
 }
 
+ElementList *ModelStructure::getUnknowns(XmlParser::Elm list) {
+    switch (list) {
+        case XmlParser::elm_Outputs: return &outputs;
+        case XmlParser::elm_Derivatives: return &derivatives;
+        case XmlParser::elm_DiscreteStates: return &discreteStates;
+        case XmlParser::elm_InitialUnknowns: return &initialUnknowns;
+        default: return NULL;
+    }
+}
+
+Dependencies *ModelStructure::getDependencies(XmlParser::Elm list) {
+    if (!getUnknowns(list)) return NULL;
+    return &dependencies[list - XmlParser::elm_Outputs];
+}
+
+static bool isDependencySeparator(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Returns the number of white space separated items of s
+static int countItems(const char *s) {
+    int n = 0;
+    while (*s) {
+        while (isDependencySeparator(*s)) s++;
+        if (!*s) break;
+        n++;
+        while (*s && !isDependencySeparator(*s)) s++;
+    }
+    return n;
+}
+
+// Returns the next item of s and its length in n, or NULL at the end. Sets s after the item.
+static const char *nextItem(const char **s, size_t *n) {
+    const char *item = *s;
+    while (isDependencySeparator(*item)) item++;
+    if (!*item) return NULL;
+    *s = item;
+    while (**s && !isDependencySeparator(**s)) (*s)++;
+    *n = *s - item;
+    return item;
+}
+
+// Returns the kind named by the n characters of kind, enu_BAD_DEFINED if it is not one
+static XmlParser::Enu dependencyKind(const char *kind, size_t n) {
+    static const XmlParser::Enu kinds[] = {
+        XmlParser::enu_dependent, XmlParser::enu_constant, XmlParser::enu_fixed,
+        XmlParser::enu_tunable, XmlParser::enu_discrete
+    };
+    for (size_t i = 0; i < sizeof(kinds) / sizeof(kinds[0]); i++) {
+        const char *name = XmlParser::enuNames[kinds[i]];
+        if (strlen(name) == n && !strncmp(name, kind, n)) return kinds[i];
+    }
+    return XmlParser::enu_BAD_DEFINED;
+}
+
+// The dependencies are counted first, so that each array is allocated once. An item
+// of dependencies that is not a number is left out together with its kind. Kinds missing
+// in dependenciesKind are enu_BAD_DEFINED, all are enu_dependent without the attribute.
+void ModelStructure::buildDependencies(Arena *arena) {
+    for (int list = XmlParser::elm_Outputs; list <= XmlParser::elm_InitialUnknowns; list++) {
+        ElementList *unknowns = getUnknowns((XmlParser::Elm)list);
+        Dependencies *d = getDependencies((XmlParser::Elm)list);
+        int rows = (int)unknowns->size();
+        int n = 0;
+        for (int i = 0; i < rows; i++) {
+            const char *deps = (*unknowns)[i]->getAttributeValue(XmlParser::att_dependencies);
+            if (deps) n += countItems(deps);
+        }
+        d->rows = rows;
+        d->unknowns = (int *)arena->allocate(rows * sizeof(int));
+        d->rowStart = (int *)arena->allocate((rows + 1) * sizeof(int));
+        d->columns = (int *)arena->allocate(n * sizeof(int));
+        d->kinds = (signed char *)arena->allocate(n);
+        d->dependsOnAll = (char *)arena->allocate(rows);
+        n = 0;
+        for (int i = 0; i < rows; i++) {
+            Element *unknown = (*unknowns)[i];
+            XmlParser::ValueStatus vs;
+            const char *deps = unknown->getAttributeValue(XmlParser::att_dependencies);
+            const char *kinds = unknown->getAttributeValue(XmlParser::att_dependenciesKind);
+            const char *item;
+            size_t length;
+            d->unknowns[i] = unknown->getAttributeInt(XmlParser::att_index, &vs);
+            d->rowStart[i] = n;
+            d->dependsOnAll[i] = deps == NULL;
+            while (deps && (item = nextItem(&deps, &length)) != NULL) {
+                const char *kind = NULL;
+                size_t kindLength = 0;
+                char *end;
+                long column = strtol(item, &end, 10);
+                if (kinds) kind = nextItem(&kinds, &kindLength);
+                if (end != item + length) continue;
+                d->columns[n] = (int)column;
+                d->kinds[n] = (signed char)(!kinds ? XmlParser::enu_dependent
+                                            : kind ? dependencyKind(kind, kindLength)
+                                            : XmlParser::enu_BAD_DEFINED);
+                n++;
+            }
+        }
+        d->rowStart[rows] = n;
+    }
+}
 
-ModelDescription::ModelDescription() {
+
+ModelDescription::ModelDescription(Arena *arena)
+    : Element(arena),
+      arena(arena),
+      mappedFile(NULL),
+      unitDefinitions(UnitList::allocator_type(arena)),
+      typeDefinitions(SimpleTypeList::allocator_type(arena)),
+      logCategories(ElementList::allocator_type(arena)),
+      vendorAnnotations(ElementList::allocator_type(arena)),
+      modelVariables(ScalarVariableList::allocator_type(arena)) {
     modelExchange = NULL;
     coSimulation = NULL;
     defaultExperiment = NULL;
     modelStructure = NULL;
-}
-ModelDescription::~ModelDescription() {
-    deleteListOfElements(unitDefinitions);
-    deleteListOfElements(typeDefinitions);
-    if (coSimulation) delete coSimulation;
-    if (modelExchange) delete modelExchange;
-    deleteListOfElements(logCategories);
-    if (defaultExperiment) delete defaultExperiment;
-    deleteListOfElements(vendorAnnotations);
-    deleteListOfElements(modelVariables);
-    if (modelStructure) delete modelStructure;
+    variablesByName = NULL;
+    variablesByValueReference = NULL;
+    typesByName = NULL;
+    variablesMask = 0;
+    typesMask = 0;
+    for (int i = 0; i < XmlParser::SIZEOF_SEC; i++) {
+        lazySections[i].element = NULL;
+        lazySections[i].from = NULL;
+        lazySections[i].to = NULL;
+    }
+    xmlPath = NULL;
+    xmlStart = NULL;
+    xmlStartLine = 0;
 }
 void ModelDescription::handleElement(XmlParser *parser, const char *childName, int isEmptyElement) {
     XmlParser::Elm childType = parser->checkElement(childName);
     switch (childType) {
     case XmlParser::elm_CoSimulation:
         {
-            coSimulation = new Component;
-            coSimulation->type = childType;
+            coSimulation = parser->newElement<Component>(childType);
             parser->parseElementAttributes(coSimulation);
             if (!isEmptyElement) {
                 parser->parseChildElements(coSimulation);
@@ -448,8 +592,7 @@ void ModelDescription::handleElement(XmlParser *parser, const char *childName, i
         }
     case XmlParser::elm_ModelExchange:
         {
-            modelExchange = new Component;
-            modelExchange->type = childType;
+            modelExchange = parser->newElement<Component>(childType);
             parser->parseElementAttributes(modelExchange);
             if (!isEmptyElement) {
                 parser->parseChildElements(modelExchange);
@@ -459,13 +602,12 @@ void ModelDescription::handleElement(XmlParser *parser, const char *childName, i
     case XmlParser::elm_UnitDefinitions:
         {
             // no attributes expected; this class handles the Category
-            if (!isEmptyElement) parser->parseChildElements(this);
+            if (!isEmptyElement) parser->parseSectionContent(this, this, XmlParser::sec_UnitDefinitions);
             break;
         }
     case XmlParser::elm_Unit:
         {
-            Unit *unit = new Unit;
-            unit->type = childType;
+            Unit *unit = parser->newElement<Unit>(childType);
             parser->parseElementAttributes(unit);
             if (!isEmptyElement) {
                 parser->parseChildElements(unit);
@@ -481,8 +623,7 @@ void ModelDescription::handleElement(XmlParser *parser, const char *childName, i
         }
     case XmlParser::elm_SimpleType:
         {
-            SimpleType *type = new SimpleType;
-            type->type = childType;
+            SimpleType *type = parser->newElement<SimpleType>(childType);
             parser->parseElementAttributes(type);
             if (!isEmptyElement) {
                 parser->parseChildElements(type);
@@ -492,8 +633,7 @@ void ModelDescription::handleElement(XmlParser *parser, const char *childName, i
         }
     case XmlParser::elm_DefaultExperiment:
         {
-            defaultExperiment = new Element;
-            defaultExperiment->type = childType;
+            defaultExperiment = parser->newElement<Element>(childType);
             parser->parseElementAttributes(defaultExperiment);
             if (!isEmptyElement) {
                 parser->parseEndElement();
@@ -508,8 +648,7 @@ void ModelDescription::handleElement(XmlParser *parser, const char *childName, i
         }
     case XmlParser::elm_Category:
         {
-            Element *category = new Element;
-            category->type = childType;
+            Element *category = parser->newElement<Element>(childType);
             parser->parseElementAttributes(category);
             if (!isEmptyElement) {
                 parser->parseEndElement();
@@ -520,13 +659,12 @@ void ModelDescription::handleElement(XmlParser *parser, const char *childName, i
     case XmlParser::elm_VendorAnnotations:
         {
             // no attributes expected; this class handles also the Tool
-            if (!isEmptyElement) parser->parseChildElements(this);
+            if (!isEmptyElement) parser->parseSectionContent(this, this, XmlParser::sec_VendorAnnotations);
             break;
         }
     case XmlParser::elm_Tool:
         {
-            Element *tool = new Element;
-            tool->type = childType;
+            Element *tool = parser->newElement<Element>(childType);
             parser->parseElementAttributes(tool);
             if (!isEmptyElement) {
                 parser->parseSkipChildElement();
@@ -537,13 +675,12 @@ void ModelDescription::handleElement(XmlParser *parser, const char *childName, i
     case XmlParser::elm_ModelVariables:
         {
             // no attributes expected; this class handles also the ScalarVariable
-            if (!isEmptyElement) parser->parseChildElements(this);
+            if (!isEmptyElement) parser->parseSectionContent(this, this, XmlParser::sec_ModelVariables);
             break;
         }
     case XmlParser::elm_ScalarVariable:
         {
-            ScalarVariable *variable = new ScalarVariable;
-            variable->type = childType;
+            ScalarVariable *variable = parser->newElement<ScalarVariable>(childType);
             parser->parseElementAttributes(variable);
             if (!isEmptyElement) {
                 parser->parseChildElements(variable);
@@ -553,11 +690,10 @@ void ModelDescription::handleElement(XmlParser *parser, const char *childName, i
         }
     case XmlParser::elm_ModelStructure:
         {
-            modelStructure = new ModelStructure;
-            modelStructure->type = childType;
+            modelStructure = parser->newElement<ModelStructure>(childType);
             parser->parseElementAttributes(modelStructure);
             if (!isEmptyElement) {
-                parser->parseChildElements(modelStructure);
+                parser->parseSectionContent(this, modelStructure, XmlParser::sec_ModelStructure);
             }
             break;
         }
@@ -572,43 +708,111 @@ void ModelDescription::printElement(int indent) {
     Element::printElement(indent);
     int childIndent = indent + 1;
 
+    for (int i = 0; i < XmlParser::SIZEOF_SEC; i++) XmlParser::parseSection(this, (XmlParser::Sec)i);
     if (coSimulation) coSimulation->printElement(childIndent);
     if (modelExchange) modelExchange->printElement(childIndent);
-    for (std::vector<Unit *>::const_iterator it = unitDefinitions.begin(); it != unitDefinitions.end(); ++it) {
+    for (UnitList::const_iterator it = unitDefinitions.begin(); it != unitDefinitions.end(); ++it) {
         (*it)->printElement(childIndent);
     }
-    for (std::vector<SimpleType *>::const_iterator it = typeDefinitions.begin(); it != typeDefinitions.end(); ++it) {
+    for (SimpleTypeList::const_iterator it = typeDefinitions.begin(); it != typeDefinitions.end(); ++it) {
         (*it)->printElement(childIndent);
     }
-    for (std::vector<Element *>::const_iterator it = logCategories.begin(); it != logCategories.end(); ++it) {
+    for (ElementList::const_iterator it = logCategories.begin(); it != logCategories.end(); ++it) {
         (*it)->printElement(childIndent);
     }
     if (defaultExperiment) defaultExperiment->printElement(childIndent);
-    for (std::vector<Element *>::const_iterator it = vendorAnnotations.begin(); it != vendorAnnotations.end(); ++it) {
+    for (ElementList::const_iterator it = vendorAnnotations.begin(); it != vendorAnnotations.end(); ++it) {
         (*it)->printElement(childIndent);
     }
-    for (std::vector<ScalarVariable *>::const_iterator it = modelVariables.begin(); it != modelVariables.end(); ++it) {
+    for (ScalarVariableList::const_iterator it = modelVariables.begin(); it != modelVariables.end(); ++it) {
         (*it)->printElement(childIndent);
     }
     if (modelStructure) modelStructure->printElement(childIndent);
 }
 
-SimpleType *ModelDescription::getSimpleType(const char *name) {
-    for (std::vector<SimpleType *>::const_iterator it = typeDefinitions.begin(); it != typeDefinitions.end(); ++it) {
+static unsigned int hashName(const char *name) {
+    unsigned int h = 2166136261u;
+    for (; *name; name++) h = (h ^ (unsigned char)*name) * 16777619u;
+    return h;
+}
+
+static unsigned int hashVr(XmlParser::Elm type, fmi2ValueReference vr) {
+    return ((unsigned int)vr * 2654435761u) ^ (unsigned int)type;
+}
+
+// Returns the mask of an index with at least 2 * n slots
+static unsigned int indexMask(size_t n) {
+    unsigned int size = 2;
+    while (size < 2 * n) size *= 2;
+    return size - 1;
+}
+
+// add element with the given name to index, unless the name is already present
+static void addName(NameIndexEntry *index, unsigned int mask, const char *name, Element *element) {
+    unsigned int h;
+    for (h = hashName(name) & mask; index[h].element; h = (h + 1) & mask) {
+        if (!strcmp(index[h].name, name)) return;
+    }
+    index[h].name = name;
+    index[h].element = element;
+}
+
+static Element *findName(NameIndexEntry *index, unsigned int mask, const char *name) {
+    if (!index || !name) return NULL;
+    for (unsigned int h = hashName(name) & mask; index[h].element; h = (h + 1) & mask) {
+        if (!strcmp(index[h].name, name)) return index[h].element;
+    }
+    return NULL;
+}
+
+void ModelDescription::buildIndexes() {
+    typesMask = indexMask(typeDefinitions.size());
+    typesByName = (NameIndexEntry *)arena->allocate((typesMask + 1) * sizeof(NameIndexEntry));
+    memset(typesByName, 0, (typesMask + 1) * sizeof(NameIndexEntry));
+    for (SimpleTypeList::const_iterator it = typeDefinitions.begin(); it != typeDefinitions.end(); ++it) {
         const char *typeName = (*it)->getAttributeValue(XmlParser::att_name);
-        if (typeName && 0 == strcmp(typeName, name)) {
-            return (*it);
+        if (typeName) addName(typesByName, typesMask, typeName, *it);
+    }
+
+    variablesMask = indexMask(modelVariables.size());
+    variablesByName = (NameIndexEntry *)arena->allocate((variablesMask + 1) * sizeof(NameIndexEntry));
+    memset(variablesByName, 0, (variablesMask + 1) * sizeof(NameIndexEntry));
+    variablesByValueReference = (VrIndexEntry *)arena->allocate((variablesMask + 1) * sizeof(VrIndexEntry));
+    memset(variablesByValueReference, 0, (variablesMask + 1) * sizeof(VrIndexEntry));
+    for (ScalarVariableList::const_iterator it = modelVariables.begin(); it != modelVariables.end(); ++it) {
+        ScalarVariable *sv = *it;
+        const char *varName = sv->getAttributeValue(XmlParser::att_name);
+        if (varName) addName(variablesByName, variablesMask, varName, sv);
+        XmlParser::ValueStatus vs;
+        fmi2ValueReference vr = sv->getAttributeUInt(XmlParser::att_valueReference, &vs);
+        if (vs != XmlParser::valueDefined || !sv->typeSpec) continue;
+        XmlParser::Elm type = sv->typeSpec->type;
+        unsigned int h;
+        for (h = hashVr(type, vr) & variablesMask; variablesByValueReference[h].variable; h = (h + 1) & variablesMask) {
+            if (variablesByValueReference[h].vr == vr && variablesByValueReference[h].type == type) break;
+        }
+        if (!variablesByValueReference[h].variable) {
+            variablesByValueReference[h].variable = sv;
+            variablesByValueReference[h].vr = vr;
+            variablesByValueReference[h].type = type;
         }
     }
-    return NULL;
+}
+
+SimpleType *ModelDescription::getSimpleType(const char *name) {
+    return (SimpleType *)findName(typesByName, typesMask, name);
 }
 
 ScalarVariable *ModelDescription::getVariable(const char *name) {
-    if (!name) return NULL;
-    for (std::vector<ScalarVariable *>::const_iterator it = modelVariables.begin(); it != modelVariables.end(); ++it) {
-        const char *varName = (*it)->getAttributeValue(XmlParser::att_name);
-        if (varName && 0 == strcmp(name, varName)) {
-            return (*it);
+    return (ScalarVariable *)findName(variablesByName, variablesMask, name);
+}
+
+ScalarVariable *ModelDescription::getVariable(XmlParser::Elm type, fmi2ValueReference vr) {
+    if (!variablesByValueReference) return NULL;
+    for (unsigned int h = hashVr(type, vr) & variablesMask; variablesByValueReference[h].variable;
+            h = (h + 1) & variablesMask) {
+        if (variablesByValueReference[h].vr == vr && variablesByValueReference[h].type == type) {
+            return variablesByValueReference[h].variable;
         }
     }
     return NULL;
@@ -14,17 +14,58 @@
 #ifndef XML_ELEMENT_H
 #define XML_ELEMENT_H
 
-#include <map>
 #include <vector>
 #include "XmlParser.h"
+#include "XmlCache.h"
+
+class Element;
+class Unit;
+class SimpleType;
+class ScalarVariable;
+
+// lists of elements, with the buffer in the arena of the model description
+typedef std::vector<Element *, ArenaAllocator<Element *> > ElementList;
+typedef std::vector<Unit *, ArenaAllocator<Unit *> > UnitList;
+typedef std::vector<SimpleType *, ArenaAllocator<SimpleType *> > SimpleTypeList;
+typedef std::vector<ScalarVariable *, ArenaAllocator<ScalarVariable *> > ScalarVariableList;
+
+// parsed value of an attribute in Element::TYPED_ATTRIBUTES
+struct TypedValue {
+    double real;        // value of getAttributeDouble, 0 if not valueDefined
+    int integer;        // value of getAttributeInt and getAttributeUInt, 0 if not valueDefined
+    char realStatus;    // XmlParser::ValueStatus of real
+    char integerStatus; // XmlParser::ValueStatus of integer
+};
 
+// Elements are created with XmlParser::newElement in the arena of the model description and
+// are never deleted one by one, the arena is deleted by freeModelDescription.
 class Element {
  public:
     XmlParser::Elm type;  // element type
-    std::map<XmlParser::Att, char*> attributes;  // map with key one of XmlParser::Att
+    // The attributes present are flagged in attributeMask, bit i for XmlParser::Att i, which
+    // requires SIZEOF_ATT <= 64. Their values are packed in attributeValues in the order of
+    // XmlParser::Att, so the value of att is at the number of bits set below bit att.
+    unsigned long long attributeMask;
+    char **attributeValues;
+    // The numeric attributes queried per variable are parsed once, when the element is
+    // created. Their values follow the attributeValues in the same allocation, see
+    // typedValues, and are packed like them: the value of att is at the number of bits set
+    // in attributeMask & TYPED_ATTRIBUTES below bit att.
+    static const unsigned long long TYPED_ATTRIBUTES =
+        (1ULL << XmlParser::att_valueReference) | (1ULL << XmlParser::att_start)
+        | (1ULL << XmlParser::att_min) | (1ULL << XmlParser::att_max) | (1ULL << XmlParser::att_nominal)
+        | (1ULL << XmlParser::att_derivative) | (1ULL << XmlParser::att_index);
 
  public:
-    virtual ~Element();
+    explicit Element(Arena *arena);
+    // bytes to allocate for attributeValues with the attributes in mask, typed values included
+    static size_t valuesSize(unsigned long long mask);
+    // the typed values behind attributeValues
+    TypedValue *typedValues() { return (TypedValue *)(attributeValues + getAttributeCount()); }
+    // set the typed values from attributeValues, allocated with valuesSize
+    void parseTypedValues();
+    const TypedValue *getTypedValue(XmlParser::Att att);  // NULL if not present or not typed
+    int getAttributeCount();  // number of attributes present
     virtual void handleElement(XmlParser *parser, const char *childName, int isEmptyElement);
     virtual void printElement(int indent);
     const char *getAttributeValue(XmlParser::Att att);  // value or NULL if not present
@@ -33,17 +74,16 @@ class Element {
     double getAttributeDouble(XmlParser::Att att, XmlParser::ValueStatus *vs);
     bool getAttributeBool(XmlParser::Att att, XmlParser::ValueStatus *vs);
 
-    template <typename T> void printListOfElements(int indent, const std::vector<T *> &list);
-    template <typename T> void deleteListOfElements(const std::vector<T *> &list);
+    template <typename L> void printListOfElements(int indent, const L &list);
 };
 
 
 class ListElement : public Element {
  public:
-    std::vector<Element*> list;  // list of Element
+    ElementList list;  // list of Element
 
  public:
-    ~ListElement();
+    explicit ListElement(Arena *arena);
     void handleElement(XmlParser *parser, const char *childName, int isEmptyElement);
     void printElement(int indent);
 };
@@ -51,12 +91,11 @@ class ListElement : public Element {
 
 class Unit : public Element {
  public:
-    std::vector<Element *> displayUnits;  // list of DisplayUnit
-    Element *baseUnit;                    // null or BaseUnit
+    ElementList displayUnits;  // list of DisplayUnit
+    Element *baseUnit;         // null or BaseUnit
 
  public:
-    Unit();
-    ~Unit();
+    explicit Unit(Arena *arena);
     void handleElement(XmlParser *parser, const char *childName, int isEmptyElement);
     void printElement(int indent);
 };
@@ -67,8 +106,7 @@ class SimpleType : public Element {
     Element *typeSpec;  // one of RealType, IntegerType etc.
 
  public:
-    SimpleType();
-    ~SimpleType();
+    explicit SimpleType(Arena *arena);
     void handleElement(XmlParser *parser, const char *childName, int isEmptyElement);
     void printElement(int indent);
 };
@@ -76,10 +114,10 @@ class SimpleType : public Element {
 
 class Component : public Element {
  public:
-    std::vector<Element *> files;  // list of File. Only meaningful for source code FMUs (not .dll).
+    ElementList files;  // list of File. Only meaningful for source code FMUs (not .dll).
 
  public:
-    ~Component();
+    explicit Component(Arena *arena);
     void handleElement(XmlParser *parser, const char *childName, int isEmptyElement);
     void printElement(int indent);
 };
@@ -88,12 +126,11 @@ class Component : public Element {
 class ScalarVariable : public Element {
  public :
     Element *typeSpec;                   // one of Real, Integer, etc
-    std::vector<Element *> annotations;  // list of Annotations
+    ElementList *annotations;            // NULL or list of Tool, created with the first one
     // int modelIdx;                     // only used in fmu10
 
  public:
-    ScalarVariable();
-    ~ScalarVariable();
+    explicit ScalarVariable(Arena *arena);
     void handleElement(XmlParser *parser, const char *childName, int isEmptyElement);
     void printElement(int indent);
     // get the valueReference of current variable. This attribute is mandatory for a variable.
@@ -109,45 +146,105 @@ class ScalarVariable : public Element {
 };
 
 
+// Dependencies of the Unknowns of a list of ModelStructure in compressed sparse row form,
+// row i is the Unknown at i. See getDependencyGraph in XmlParserCApi.h. The arrays are in
+// the arena of the model description.
+struct Dependencies {
+    int rows;
+    int *unknowns;       // index of each row
+    int *rowStart;       // rows + 1 offsets into columns and kinds
+    int *columns;        // index of each dependency
+    signed char *kinds;  // XmlParser::Enu of each dependency
+    char *dependsOnAll;  // of each row, 1 if it has no dependencies attribute
+};
+
 class ModelStructure : public Element {
  private:
     XmlParser::Elm unknownParentType;  // used in handleElement to know in which list next Unknown belongs.
 
  public:
-    std::vector<Element *> outputs;            // list of Unknown
-    std::vector<Element *> derivatives;        // list of Unknown
-    std::vector<Element *> discreteStates;     // list of Unknown
-    std::vector<Element *> initialUnknowns;    // list of Unknown
+    ElementList outputs;            // list of Unknown
+    ElementList derivatives;        // list of Unknown
+    ElementList discreteStates;     // list of Unknown
+    ElementList initialUnknowns;    // list of Unknown
+    // dependencies of outputs, derivatives, discreteStates and initialUnknowns,
+    // built by buildDependencies
+    Dependencies dependencies[4];
 
  public:
-    ModelStructure();
-    ~ModelStructure();
+    explicit ModelStructure(Arena *arena);
     void handleElement(XmlParser *parser, const char *childName, int isEmptyElement);
     void printElement(int indent);
+    // parse the dependencies and dependenciesKind of all Unknowns into dependencies.
+    // Called by the parser when the Unknowns are parsed.
+    void buildDependencies(Arena *arena);
+    // list of Unknowns of elm_Outputs, elm_Derivatives, ..., NULL for other types
+    ElementList *getUnknowns(XmlParser::Elm list);
+    // dependencies of a list of getUnknowns, NULL for other types
+    Dependencies *getDependencies(XmlParser::Elm list);
+};
+
+// slots of the hash indexes of ModelDescription, empty if the element is NULL
+struct NameIndexEntry {
+    const char *name;
+    Element *element;
+};
+struct VrIndexEntry {
+    ScalarVariable *variable;
+    fmi2ValueReference vr;
+    XmlParser::Elm type;  // type of the typeSpec of the variable
+};
+
+// content of a section of ModelDescription parsed on first access, see XmlParser::setLazy
+struct LazySection {
+    Element *element;  // that handles the children: the ModelDescription or its ModelStructure
+    char *from;        // range of the content in the xml file, from is NULL if not lazy or parsed
+    char *to;
 };
 
 class ModelDescription : public Element {
+ private:
+    // hash indexes built by buildIndexes, open addressing with linear probing.
+    // The number of slots is a power of 2, mask is the number of slots - 1.
+    NameIndexEntry *variablesByName;
+    VrIndexEntry *variablesByValueReference;
+    NameIndexEntry *typesByName;
+    unsigned int variablesMask;
+    unsigned int typesMask;
+
  public:
-    std::vector<Unit *> unitDefinitions;        // list of Units
-    std::vector<SimpleType *> typeDefinitions;  // list of Types
+    Arena *arena;                               // holds this and all other elements
+    MappedFile *mappedFile;                     // NULL or the cache or xml file the attribute values point into
+    UnitList unitDefinitions;                   // list of Units
+    SimpleTypeList typeDefinitions;             // list of Types
     Component *modelExchange;                   // NULL or ModelExchange
     Component *coSimulation;                    // NULL or CoSimulation
                                                 // At least one of CoSimulation, ModelExchange must be present.
-    std::vector<Element *> logCategories;       // list of Category
+    ElementList logCategories;                  // list of Category
     Element *defaultExperiment;                 // NULL or DefaultExperiment
-    std::vector<Element *> vendorAnnotations;   // list of Tools
-    std::vector<ScalarVariable *> modelVariables;  // list of ScalarVariable
+    ElementList vendorAnnotations;              // list of Tools
+    ScalarVariableList modelVariables;          // list of ScalarVariable
     ModelStructure *modelStructure;             // not NULL ModelStructure
+    LazySection lazySections[XmlParser::SIZEOF_SEC];  // see XmlParser::setLazy
+    char *xmlPath;                              // of the lazy sections, NULL if there are none
+    char *xmlStart;                             // of the tokenized xml file, for line numbers
+    int xmlStartLine;
 
  public:
-    ModelDescription();
-    ~ModelDescription();
+    explicit ModelDescription(Arena *arena);
     void handleElement(XmlParser *parser, const char *childName, int isEmptyElement);
     void printElement(int indent);
+    // build the indexes of the variables by name and by type and value reference, and of the
+    // types by name. Called by the parser when all variables and types are parsed. The first
+    // of several variables or types with the same key is indexed, as found by a linear search.
+    void buildIndexes();
     // get the SimpleType definition by name, if any. NULL if not found.
     SimpleType *getSimpleType(const char *name);
     // get the ScalarVariable by name, if any. NULL if not found.
     ScalarVariable *getVariable(const char *name);
+    // get the first ScalarVariable with a typeSpec of the given type, e.g. elm_Real, and the
+    // given valueReference, if any. NULL if not found.
+    ScalarVariable *getVariable(XmlParser::Elm type, fmi2ValueReference vr);
     // get description from variable, if not present look for type definition description.
     const char *getDescriptionForVariable(ScalarVariable *sv);
     // get attribute from type, if not present look for it inside declared type.
@@ -6,18 +6,29 @@
  * XmlParser.cpp
  * Parser implementation for xml model description file of a FMI 2.0 model.
  * The result of parsing is a ModelDescription object that can be queried to
- * get necessary information. The parsing is based on libxml2.lib.
+ * get necessary information. The parsing is based on libxml2.lib, or on
+ * XmlTokenizer, see XmlParser.h.
  *
  * Author: Adrian Tirea
  * ---------------------------------------------------------------------------*/
 
 #include "XmlParser.h"
+#include <string>
 #include <utility>
 #include <vector>
 #include "XmlElement.h"
 #include "XmlParserException.h"
+#include "XmlTokenizer.h"
 #include <cstring> // strdup()
 
+#ifdef _MSC_VER
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
 #ifdef STANDALONE_XML_PARSER
 #define logThis(n, ...) printf(__VA_ARGS__); printf("\n")
 #define checkStrdup(str) strdup(str)
@@ -69,30 +80,65 @@ const char *XmlParser::enuNames[SIZEOF_ENU] = {
 
 XmlParser::XmlParser(char *xmlPath) {
     this->xmlPath = (char *)checkStrdup(xmlPath);
+    tokenize = false;
+    xmlReader = NULL;
+    tokenizer = NULL;
+    arena = NULL;
+    threads = 1;
+    lazy = false;
+}
+
+XmlParser::XmlParser(char *xmlPath, bool tokenize) {
+    this->xmlPath = (char *)checkStrdup(xmlPath);
+    this->tokenize = tokenize;
     xmlReader = NULL;
+    tokenizer = NULL;
+    arena = NULL;
+    threads = 1;
+    lazy = false;
 }
 
 XmlParser::~XmlParser() {
     free(xmlPath);
+    delete arena;
+}
+
+void XmlParser::setThreads(int threads) {
+    this->threads = threads > 0 ? threads : processorCount();
+}
+
+void XmlParser::setLazy(bool lazy) {
+    this->lazy = lazy;
 }
 
 ModelDescription *XmlParser::parse() {
-    xmlReader = xmlReaderForFile(xmlPath, NULL, 0);
     ModelDescription *md = NULL;
-    if (xmlReader != NULL) {
+    MappedFile *xmlFile = NULL;  // read by the tokenizer, the attribute values point into it
+    delete arena;
+    arena = new Arena;
+    if (tokenize) {
+        xmlFile = MappedFile::open(xmlPath);
+    } else {
+        xmlReader = xmlReaderForFile(xmlPath, NULL, 0);
+    }
+    if (xmlReader != NULL || xmlFile != NULL) {
         try {
+            if (xmlFile) tokenizer = new XmlTokenizer(xmlPath, xmlFile->data, xmlFile->size, arena);
             if (readNextInXml()) {
                 // I expect that first element is fmiModelDescription.
-                if (0 != strcmp((char *)xmlTextReaderConstLocalName(xmlReader), elmNames[elm_fmiModelDescription])) {
+                if (0 != strcmp(localName(), elmNames[elm_fmiModelDescription])) {
                     throw XmlParserException("Expected '%s' element. Found instead: '%s'.",
                         elmNames[elm_fmiModelDescription],
-                        xmlTextReaderConstLocalName(xmlReader));
+                        localName());
                 }
 
-                md = new ModelDescription;
-                md->type = elm_fmiModelDescription;
+                md = newElement<ModelDescription>(elm_fmiModelDescription);
                 parseElementAttributes((Element *)md);
                 parseChildElements(md);
+                // only comments and white space may follow, the tokenizer throws otherwise
+                if (tokenizer) tokenizer->read();
+                md->buildIndexes();
+                if (md->modelStructure) md->modelStructure->buildDependencies(arena);
             } else {
                 throw XmlParserException("Syntax error parsing xml file '%s'", xmlPath);
             }
@@ -103,43 +149,120 @@ ModelDescription *XmlParser::parse() {
             logThis(ERROR_FATAL, "Out of memory");
             md = NULL;
         }
-        xmlFreeTextReader(xmlReader);
+        if (xmlReader) xmlFreeTextReader(xmlReader);
+        xmlReader = NULL;
+        delete tokenizer;
+        tokenizer = NULL;
     } else {
         logThis(ERROR_ERROR, "Unable to open '%s'", xmlPath);
     }
 
-    return validate(md);
+    md = validate(md);
+    if (md) {
+        // the arena and the xml file now belong to md, see freeModelDescription
+        arena = NULL;
+        md->mappedFile = xmlFile;
+    } else {
+        delete xmlFile;
+    }
+    return md;
 }
 
-// Returns the index of name in the array.
-// Throw exception if name not found (invalid).
-static int checkName(const char *name, const char *kind, const char *array[], int n) {
-    for (int i = 0; i < n; i++) {
-        if (!strcmp(name, array[i])) {
-            return i;
+// Perfect hash table for a fixed vocabulary of names. The seed of the hash is
+// searched when the table is built, such that each name gets a slot of its own.
+// Looking up a name then takes one hash and one strcmp. A vocabulary without a
+// seed within MAX_SEED falls back to the linear search.
+class NameTable {
+ private:
+    static const unsigned int SIZE = 1024;  // slots, a power of 2 much larger than SIZEOF_ATT
+    static const unsigned int MAX_SEED = 10000;
+    const char **names;
+    int n;
+    unsigned int seed;  // 0 if no seed has been found
+    short slots[SIZE];  // index of the name in names, or -1
+
+    static unsigned int hash(const char *name, unsigned int seed) {
+        unsigned int h = 2166136261u ^ seed;
+        for (; *name; name++) h = (h ^ (unsigned char)*name) * 16777619u;
+        return (h ^ (h >> 15)) & (SIZE - 1);
+    }
+
+ public:
+    NameTable(const char *names[], int n) : names(names), n(n), seed(0) {
+        for (unsigned int s = 1; s <= MAX_SEED; s++) {
+            int i;
+            for (unsigned int k = 0; k < SIZE; k++) slots[k] = -1;
+            for (i = 0; i < n; i++) {
+                unsigned int h = hash(names[i], s);
+                if (slots[h] >= 0) break;  // collision, try the next seed
+                slots[h] = (short)i;
+            }
+            if (i == n) {
+                seed = s;
+                return;
+            }
+        }
+    }
+    // Returns the index of name in names, or -1 if not found.
+    int find(const char *name) const {
+        if (seed) {
+            int i = slots[hash(name, seed)];
+            return i >= 0 && !strcmp(name, names[i]) ? i : -1;
         }
+        for (int i = 0; i < n; i++) {
+            if (!strcmp(name, names[i])) return i;
+        }
+        return -1;
+    }
+};
+
+static const NameTable elmTable(XmlParser::elmNames, XmlParser::SIZEOF_ELM);
+static const NameTable attTable(XmlParser::attNames, XmlParser::SIZEOF_ATT);
+static const NameTable enuTable(XmlParser::enuNames, XmlParser::SIZEOF_ENU);
+
+// Returns the index of name in the vocabulary of the table.
+// Throw exception if name not found (invalid).
+static int checkName(const char *name, const char *kind, const NameTable &table) {
+    int i = table.find(name);
+    if (i < 0) {
+        throw XmlParserException("Illegal %s %s", kind, name);
     }
-    throw XmlParserException("Illegal %s %s", kind, name);
+    return i;
 }
 
 XmlParser::Att XmlParser::checkAttribute(const char *att) {
-    return (XmlParser::Att)checkName(att, "attribute", XmlParser::attNames, XmlParser::SIZEOF_ATT);
+    return (XmlParser::Att)checkName(att, "attribute", attTable);
 }
 
 void XmlParser::parseElementAttributes(Element *element) {
-    while (xmlTextReaderMoveToNextAttribute(xmlReader)) {
-        xmlChar *name = xmlTextReaderName(xmlReader);
-        xmlChar *value = xmlTextReaderValue(xmlReader);
-        XmlParser::Att key = checkAttribute((char *)name);
-        char *theValue = value ? (char *)checkStrdup((char *)value) : NULL;
-        element->attributes.insert(std::pair<XmlParser::Att, char *>(key, theValue));
-        xmlFree(name);
-        xmlFree(value);
+    // collect the values by attribute, then pack them in the order of Att.
+    // The first of several values of an attribute is kept.
+    char *values[SIZEOF_ATT];
+    unsigned long long mask = 0;
+    int n = 0;
+    const char *name;
+    char *value;
+    while (readNextAttribute(&name, &value)) {
+        XmlParser::Att key = checkAttribute(name);
+        if (mask & (1ULL << key)) continue;
+        values[key] = value;
+        mask |= 1ULL << key;
+        n++;
     }
+    element->attributeMask = mask;
+    element->attributeValues = NULL;
+    if (n > 0) {
+        element->attributeValues = (char **)arena->allocate(Element::valuesSize(mask));
+        int k = 0;
+        for (int att = 0; att < SIZEOF_ATT; att++) {
+            if (mask & (1ULL << att)) element->attributeValues[k++] = values[att];
+        }
+    }
+    element->parseTypedValues();
 }
 
 void XmlParser::parseChildElements(Element *el) {
-    int elementIsEmpty = xmlTextReaderIsEmptyElement(xmlReader);
+    int elementIsEmpty = isEmptyElement();
     if (elementIsEmpty == -1) {
         throw XmlParserException("Error parsing xml file '%s'", xmlPath);
     } else if (elementIsEmpty == 1) {
@@ -147,17 +270,382 @@ void XmlParser::parseChildElements(Element *el) {
     }
 
     bool ret = readNextInXml();
-    while (ret  && xmlTextReaderNodeType(xmlReader) != XML_READER_TYPE_END_ELEMENT) {
-        if (xmlTextReaderNodeType(xmlReader) == XML_READER_TYPE_ELEMENT) {
-            const char *localName = (char *)xmlTextReaderConstLocalName(xmlReader);
-            int depthBefore = xmlTextReaderDepth(xmlReader);
-            int isEmptyElement = xmlTextReaderIsEmptyElement(xmlReader);
-            el->handleElement(this, localName, isEmptyElement);
-            if (!isEmptyElement) {
-                int depthAfter = xmlTextReaderDepth(xmlReader);
-                if (depthBefore != depthAfter) {
-                    throw XmlParserException("Parser error. Depth wrong after parsing sub-tree for %s.", localName);
-                }
+    while (ret  && !isEndElementNode()) {
+        if (isElementNode()) parseChildElement(el);
+        ret = readNextInXml();
+    }
+    if (!ret) {
+        throw XmlParserException("Error parsing xml file '%s'", xmlPath);
+    }
+}
+
+void XmlParser::parseChildElement(Element *el) {
+    const char *childName = localName();
+    int depthBefore = depth();
+    int childIsEmpty = isEmptyElement();
+    el->handleElement(this, childName, childIsEmpty);
+    if (!childIsEmpty) {
+        int depthAfter = depth();
+        if (depthBefore != depthAfter) {
+            throw XmlParserException("Parser error. Depth wrong after parsing sub-tree for %s.", childName);
+        }
+    }
+}
+
+void XmlParser::parseFragment(Element *el) {
+    // the tokenizer of a fragment returns no end tag of an enclosing element
+    while (readNextInXml()) {
+        parseChildElement(el);
+    }
+}
+
+/* -------------------------------------------------------------------------*
+ * Parallel parse of the ScalarVariables with the tokenizer.
+ * The tokenizer first scans ModelVariables for the start of each variable.
+ * The variables are then split into chunks of consecutive variables, which
+ * are parsed by fragment tokenizers on worker threads into arenas of their
+ * own, and appended to the model description in document order.
+ * -------------------------------------------------------------------------*/
+
+// fewer variables are not worth a thread
+static const size_t MIN_CHUNK_VARIABLES = 1024;
+
+struct XmlParser::Chunk {
+    XmlParser *parser;        // of the document
+    char *from;               // range of the variables in the buffer of the tokenizer
+    char *to;
+    Arena *arena;             // of the worker, adopted by the arena of the document
+    ModelDescription *part;   // collects the variables of the chunk, in arena
+    const char *errorAt;      // error found by the tokenizer of the chunk, or NULL
+    const char *errorMessage;
+    std::string error;        // other error, or empty
+    bool outOfMemory;
+
+    void run() {
+        XmlParser worker(parser->xmlPath, true);
+        XmlTokenizer fragment(parser->xmlPath, parser->tokenizer->documentStart(),
+            parser->tokenizer->documentStartLine(), from, to, arena);
+        worker.arena = arena;
+        worker.tokenizer = &fragment;
+        try {
+            part = worker.newElement<ModelDescription>(elm_fmiModelDescription);
+            worker.parseFragment(part);
+        } catch (XmlParserException &e) {
+            if (!fragment.fragmentError(&errorAt, &errorMessage)) error = e.what();
+        } catch (std::bad_alloc &) {
+            outOfMemory = true;
+        }
+        worker.arena = NULL;  // belongs to the parser of the document
+        worker.tokenizer = NULL;
+    }
+};
+
+#ifdef _MSC_VER
+typedef HANDLE Thread;
+
+static unsigned __stdcall runChunk(void *chunk) {
+    ((XmlParser::Chunk *)chunk)->run();
+    return 0;
+}
+
+// Returns false if the thread could not be created
+static bool startThread(Thread *thread, XmlParser::Chunk *chunk) {
+    *thread = (HANDLE)_beginthreadex(NULL, 0, runChunk, chunk, 0, NULL);
+    return *thread != 0;
+}
+
+static void joinThread(Thread thread) {
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+
+int XmlParser::processorCount() {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+}
+#else
+typedef pthread_t Thread;
+
+static void *runChunk(void *chunk) {
+    ((XmlParser::Chunk *)chunk)->run();
+    return NULL;
+}
+
+// Returns false if the thread could not be created
+static bool startThread(Thread *thread, XmlParser::Chunk *chunk) {
+    return pthread_create(thread, NULL, runChunk, chunk) == 0;
+}
+
+static void joinThread(Thread thread) {
+    pthread_join(thread, NULL);
+}
+
+int XmlParser::processorCount() {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+#endif  // _MSC_VER
+
+void XmlParser::parseModelVariables(ModelDescription *md) {
+    std::vector<char *> starts;
+    char *endTag;
+    size_t nChunks = 0;
+    if (tokenizer && threads > 1
+            && tokenizer->scanChildren(elmNames[elm_ScalarVariable], &starts, &endTag)) {
+        nChunks = starts.size() / MIN_CHUNK_VARIABLES;
+        if (nChunks > (size_t)threads) nChunks = threads;
+    }
+    if (nChunks < 2) {
+        parseChildElements(md);
+        return;
+    }
+
+    std::vector<Chunk> chunks(nChunks);
+    for (size_t i = 0; i < nChunks; i++) {
+        Chunk &c = chunks[i];
+        c.parser = this;
+        c.from = starts[i * starts.size() / nChunks];
+        c.to = i + 1 < nChunks ? starts[(i + 1) * starts.size() / nChunks] : endTag;
+        c.arena = new (arena->allocate(sizeof(Arena))) Arena;
+        c.part = NULL;
+        c.errorAt = NULL;
+        c.errorMessage = NULL;
+        c.outOfMemory = false;
+    }
+    // the first chunk is parsed on this thread, and every chunk without a thread
+    std::vector<Thread> workers(nChunks);
+    std::vector<bool> started(nChunks, false);
+    for (size_t i = 1; i < nChunks; i++) {
+        started[i] = startThread(&workers[i], &chunks[i]);
+    }
+    chunks[0].run();
+    for (size_t i = 1; i < nChunks; i++) {
+        if (started[i]) joinThread(workers[i]);
+        else chunks[i].run();
+    }
+
+    // the first error in document order is reported
+    for (size_t i = 0; i < nChunks; i++) {
+        arena->adopt(chunks[i].arena);
+    }
+    for (size_t i = 0; i < nChunks; i++) {
+        Chunk &c = chunks[i];
+        if (c.errorAt) tokenizer->error(c.errorAt, c.errorMessage);
+        if (!c.error.empty()) throw XmlParserException("%s", c.error.c_str());
+        if (c.outOfMemory) throw std::bad_alloc();
+    }
+    md->modelVariables.reserve(md->modelVariables.size() + starts.size());
+    for (size_t i = 0; i < nChunks; i++) {
+        ScalarVariableList &variables = chunks[i].part->modelVariables;
+        md->modelVariables.insert(md->modelVariables.end(), variables.begin(), variables.end());
+    }
+    tokenizer->moveToEndTag(endTag);
+    if (!readNextInXml() || !isEndElementNode()) {
+        throw XmlParserException("Error parsing xml file '%s'", xmlPath);
+    }
+}
+
+/* -------------------------------------------------------------------------*
+ * Lazy parse of sections with the tokenizer.
+ * The content of a section is only scanned for its end, and its range in the
+ * mapped xml file is recorded in the model description. parseSection parses
+ * it on first access with a fragment tokenizer, as parseChildElements would.
+ * -------------------------------------------------------------------------*/
+
+void XmlParser::parseSectionContent(ModelDescription *md, Element *el, XmlParser::Sec section) {
+    LazySection &lazySection = md->lazySections[section];
+    char *from;
+    char *endTag;
+    // a section found twice is parsed at once, as is one that does not scan
+    if (!lazy || !tokenizer || lazySection.element) {
+        if (section == sec_ModelVariables) parseModelVariables(md);
+        else parseChildElements(el);
+        return;
+    }
+    from = tokenizer->position();
+    if (!tokenizer->scanChildren(NULL, NULL, &endTag)) {
+        parseChildElements(el);
+        return;
+    }
+    if (!md->xmlPath) {
+        md->xmlPath = arena->strdup(xmlPath);
+        md->xmlStart = tokenizer->documentStart();
+        md->xmlStartLine = tokenizer->documentStartLine();
+    }
+    lazySection.element = el;
+    lazySection.from = from;
+    lazySection.to = endTag;
+    tokenizer->moveToEndTag(endTag);
+    if (!readNextInXml() || !isEndElementNode()) {
+        throw XmlParserException("Error parsing xml file '%s'", xmlPath);
+    }
+}
+
+// remove what has been parsed of a section that has errors
+static void clearSection(ModelDescription *md, XmlParser::Sec section) {
+    switch (section) {
+        case XmlParser::sec_UnitDefinitions: md->unitDefinitions.clear(); break;
+        case XmlParser::sec_VendorAnnotations: md->vendorAnnotations.clear(); break;
+        case XmlParser::sec_ModelVariables: md->modelVariables.clear(); break;
+        case XmlParser::sec_ModelStructure:
+            md->modelStructure->outputs.clear();
+            md->modelStructure->derivatives.clear();
+            md->modelStructure->discreteStates.clear();
+            md->modelStructure->initialUnknowns.clear();
+            break;
+    }
+}
+
+void XmlParser::parseSection(ModelDescription *md, XmlParser::Sec section) {
+    LazySection &lazySection = md->lazySections[section];
+    if (!lazySection.from) return;
+    XmlParser parser(md->xmlPath, true);
+    XmlTokenizer fragment(md->xmlPath, md->xmlStart, md->xmlStartLine, lazySection.from, lazySection.to,
+        md->arena);
+    lazySection.from = NULL;  // parsed only once, also if it fails
+    parser.arena = md->arena;
+    parser.tokenizer = &fragment;
+    try {
+        parser.parseFragment(lazySection.element);
+        if (section == sec_ModelVariables && parser.validateVariables(md) > 0) {
+            logThis(ERROR_ERROR, "Found errors in the model variables of file %s", md->xmlPath);
+            clearSection(md, section);
+        }
+    } catch (XmlParserException& e) {
+        const char *at;
+        const char *message;
+        if (fragment.fragmentError(&at, &message)) {
+            logThis(ERROR_ERROR, "Error parsing xml file '%s' at line %d: %s", md->xmlPath,
+                fragment.lineNumber(at), message);
+        } else {
+            logThis(ERROR_ERROR, e.what());
+        }
+        clearSection(md, section);
+    } catch (std::bad_alloc& ) {
+        logThis(ERROR_FATAL, "Out of memory");
+        clearSection(md, section);
+    }
+    if (section == sec_ModelVariables) md->buildIndexes();
+    if (section == sec_ModelStructure) md->modelStructure->buildDependencies(md->arena);
+    parser.arena = NULL;  // belongs to md
+    parser.tokenizer = NULL;
+}
+
+/* -------------------------------------------------------------------------*
+ * Streaming of the elements to an XmlStreamHandler.
+ * The sections that hold lists of elements are only descended into. Each
+ * element of such a list and each other child of fmiModelDescription is
+ * created with its children in the arena, passed to the handler, and the
+ * arena is cleared for the next one.
+ * -------------------------------------------------------------------------*/
+
+// type of the elements streamed from the content of a section, elm_BAD_DEFINED for an
+// element that is streamed itself
+static XmlParser::Elm streamedChild(XmlParser::Elm section) {
+    switch (section) {
+        case XmlParser::elm_UnitDefinitions: return XmlParser::elm_Unit;
+        case XmlParser::elm_TypeDefinitions: return XmlParser::elm_SimpleType;
+        case XmlParser::elm_LogCategories: return XmlParser::elm_Category;
+        case XmlParser::elm_ModelVariables: return XmlParser::elm_ScalarVariable;
+        case XmlParser::elm_ModelStructure:
+        case XmlParser::elm_Outputs:
+        case XmlParser::elm_Derivatives:
+        case XmlParser::elm_DiscreteStates:
+        case XmlParser::elm_InitialUnknowns: return XmlParser::elm_Unknown;
+        default: return XmlParser::elm_BAD_DEFINED;
+    }
+}
+
+// true if an element of type may be a child of parent
+static bool isStreamedChild(XmlParser::Elm parent, XmlParser::Elm type) {
+    switch (parent) {
+        case XmlParser::elm_fmiModelDescription:
+            return type == XmlParser::elm_ModelExchange || type == XmlParser::elm_CoSimulation
+                || type == XmlParser::elm_UnitDefinitions || type == XmlParser::elm_TypeDefinitions
+                || type == XmlParser::elm_LogCategories || type == XmlParser::elm_DefaultExperiment
+                || type == XmlParser::elm_VendorAnnotations || type == XmlParser::elm_ModelVariables
+                || type == XmlParser::elm_ModelStructure;
+        case XmlParser::elm_ModelStructure:
+            return type == XmlParser::elm_Outputs || type == XmlParser::elm_Derivatives
+                || type == XmlParser::elm_DiscreteStates || type == XmlParser::elm_InitialUnknowns;
+        default:
+            return type == streamedChild(parent);
+    }
+}
+
+bool XmlParser::stream(XmlStreamHandler *handler) {
+    bool ok = false;
+    MappedFile *xmlFile = NULL;  // read by the tokenizer
+    Arena documentArena;         // for the tokenizer, the arena of the parser is cleared
+    delete arena;
+    arena = new Arena;
+    if (tokenize) {
+        xmlFile = MappedFile::open(xmlPath);
+    } else {
+        xmlReader = xmlReaderForFile(xmlPath, NULL, 0);
+    }
+    if (xmlReader != NULL || xmlFile != NULL) {
+        try {
+            if (xmlFile) tokenizer = new XmlTokenizer(xmlPath, xmlFile->data, xmlFile->size, &documentArena);
+            if (!readNextInXml()) {
+                throw XmlParserException("Syntax error parsing xml file '%s'", xmlPath);
+            }
+            if (0 != strcmp(localName(), elmNames[elm_fmiModelDescription])) {
+                throw XmlParserException("Expected '%s' element. Found instead: '%s'.",
+                    elmNames[elm_fmiModelDescription],
+                    localName());
+            }
+            int rootIsEmpty = isEmptyElement();
+            if (rootIsEmpty == -1) {
+                throw XmlParserException("Error parsing xml file '%s'", xmlPath);
+            }
+            bool more = true;
+            if (handler->wants(elm_fmiModelDescription)) {
+                ModelDescription *md = newElement<ModelDescription>(elm_fmiModelDescription);
+                parseElementAttributes(md);
+                more = handler->element(md, elm_BAD_DEFINED);
+                arena->clear();
+            }
+            if (more && !rootIsEmpty) more = streamChildren(handler, elm_fmiModelDescription);
+            // only comments and white space may follow, the tokenizer throws otherwise
+            if (more && tokenizer) tokenizer->read();
+            ok = true;
+        } catch (XmlParserException& e) {
+            logThis(ERROR_ERROR, e.what());
+        } catch (std::bad_alloc& ) {
+            logThis(ERROR_FATAL, "Out of memory");
+        }
+        if (xmlReader) xmlFreeTextReader(xmlReader);
+        xmlReader = NULL;
+        delete tokenizer;
+        tokenizer = NULL;
+    } else {
+        logThis(ERROR_ERROR, "Unable to open '%s'", xmlPath);
+    }
+    delete xmlFile;
+    arena->clear();
+    return ok;
+}
+
+bool XmlParser::streamChildren(XmlStreamHandler *handler, XmlParser::Elm parent) {
+    bool ret = readNextInXml();
+    while (ret && !isEndElementNode()) {
+        if (isElementNode()) {
+            const char *childName = localName();
+            XmlParser::Elm type = checkElement(childName);
+            if (!isStreamedChild(parent, type)) {
+                throw XmlParserException("Element '%s' is not expected inside of '%s'.",
+                    childName,
+                    elmNames[parent]);
+            }
+            XmlParser::Elm child = streamedChild(type);
+            if (child == elm_BAD_DEFINED && type != elm_VendorAnnotations) {
+                if (!streamElement(handler, type, parent)) return false;
+            } else if (!isEmptyElement()) {
+                // no attributes expected
+                if (type == elm_VendorAnnotations || !handler->wants(child)) skipElement();
+                else if (!streamChildren(handler, type)) return false;
             }
         }
         ret = readNextInXml();
@@ -165,11 +653,65 @@ void XmlParser::parseChildElements(Element *el) {
     if (!ret) {
         throw XmlParserException("Error parsing xml file '%s'", xmlPath);
     }
+    return true;
+}
+
+bool XmlParser::streamElement(XmlStreamHandler *handler, XmlParser::Elm type, XmlParser::Elm parent) {
+    int elementIsEmpty = isEmptyElement();
+    if (!handler->wants(type)) {
+        if (!elementIsEmpty) skipElement();
+        return true;
+    }
+    Element *element;
+    bool hasChildren = true;
+    switch (type) {
+        case elm_ModelExchange:
+        case elm_CoSimulation:
+            element = newElement<Component>(type);
+            break;
+        case elm_Unit:
+            element = newElement<Unit>(type);
+            break;
+        case elm_SimpleType:
+            element = newElement<SimpleType>(type);
+            break;
+        case elm_ScalarVariable:
+            element = newElement<ScalarVariable>(type);
+            break;
+        default:
+            // DefaultExperiment, Category and Unknown, their content is ignored as by parse
+            element = newElement<Element>(type);
+            hasChildren = false;
+            break;
+    }
+    parseElementAttributes(element);
+    if (!elementIsEmpty) {
+        if (hasChildren) parseChildElements(element);
+        else parseEndElement();
+    }
+    bool more = handler->element(element, parent);
+    arena->clear();
+    return more;
+}
+
+void XmlParser::skipElement() {
+    if (tokenizer) {
+        tokenizer->skip();
+        return;
+    }
+    int elementDepth = depth();
+    bool ret = readNextInXml();
+    while (ret && !(isEndElementNode() && depth() == elementDepth)) {
+        ret = readNextInXml();
+    }
+    if (!ret) {
+        throw XmlParserException("Error parsing xml file '%s'", xmlPath);
+    }
 }
 
 void XmlParser::parseEndElement() {
     bool ret = readNextInXml();
-    while (ret  && xmlTextReaderNodeType(xmlReader) != XML_READER_TYPE_END_ELEMENT) {
+    while (ret  && !isEndElementNode()) {
         ret = readNextInXml();
     }
     if (!ret) {
@@ -178,6 +720,10 @@ void XmlParser::parseEndElement() {
 }
 
 void XmlParser::parseSkipChildElement() {
+    if (tokenizer) {
+        tokenizer->skip();
+        return;
+    }
     int ret = xmlTextReaderNext(xmlReader);
     if (ret == -1) {
         throw XmlParserException("Error parsing xml file '%s'", xmlPath);
@@ -186,6 +732,7 @@ void XmlParser::parseSkipChildElement() {
 
 bool XmlParser::readNextInXml() {
     int ret;
+    if (tokenizer) return tokenizer->read();  // returns no comments
     do {
         ret = xmlTextReaderRead(xmlReader);
     } while (ret == 1 && xmlTextReaderNodeType(xmlReader) == XML_READER_TYPE_COMMENT);
@@ -196,16 +743,53 @@ bool XmlParser::readNextInXml() {
     return true;
 }
 
+bool XmlParser::isElementNode() {
+    if (tokenizer) return tokenizer->nodeType() == XmlTokenizer::nodeElement;
+    return xmlTextReaderNodeType(xmlReader) == XML_READER_TYPE_ELEMENT;
+}
+
+bool XmlParser::isEndElementNode() {
+    if (tokenizer) return tokenizer->nodeType() == XmlTokenizer::nodeEndElement;
+    return xmlTextReaderNodeType(xmlReader) == XML_READER_TYPE_END_ELEMENT;
+}
+
+const char *XmlParser::localName() {
+    if (tokenizer) return tokenizer->localName();
+    return (const char *)xmlTextReaderConstLocalName(xmlReader);
+}
+
+int XmlParser::isEmptyElement() {
+    if (tokenizer) return tokenizer->isEmptyElement();
+    return xmlTextReaderIsEmptyElement(xmlReader);
+}
+
+int XmlParser::depth() {
+    if (tokenizer) return tokenizer->depth();
+    return xmlTextReaderDepth(xmlReader);
+}
+
+bool XmlParser::readNextAttribute(const char **name, char **value) {
+    if (tokenizer) return tokenizer->readAttribute(name, value);
+    if (!xmlTextReaderMoveToNextAttribute(xmlReader)) return false;
+    const xmlChar *v = xmlTextReaderConstValue(xmlReader);
+    *name = (const char *)xmlTextReaderConstName(xmlReader);
+    // enumerated values like causality="local" are not copied, the names in enuNames are used
+    int enu = v ? enuTable.find((const char *)v) : -1;
+    if (enu >= 0) *value = (char *)enuNames[enu];
+    else *value = v ? arena->strdup((const char *)v) : NULL;
+    return true;
+}
+
 /* -------------------------------------------------------------------------* 
  * Helper functions to check validity of xml.
  * -------------------------------------------------------------------------*/
 
 XmlParser::Elm XmlParser::checkElement(const char *elm) {
-    return (XmlParser::Elm)checkName(elm, "element", XmlParser::elmNames, XmlParser::SIZEOF_ELM);
+    return (XmlParser::Elm)checkName(elm, "element", elmTable);
 }
 
 XmlParser::Enu XmlParser::checkEnumValue(const char *enu) {
-    return (XmlParser::Enu)checkName(enu, "enum value", XmlParser::enuNames, XmlParser::SIZEOF_ENU);
+    return (XmlParser::Enu)checkName(enu, "enum value", enuTable);
 }
 
 ModelDescription *XmlParser::validate(ModelDescription *md) {
@@ -225,9 +809,19 @@ ModelDescription *XmlParser::validate(ModelDescription *md) {
             return NULL;
     }
 
-    // check model variables
-    for (std::vector<ScalarVariable *>::const_iterator it = md->modelVariables.begin(); it != md->modelVariables.end();
-            ++it) {
+    // the model variables of a lazy model description are checked when they are parsed
+    if (!md->lazySections[sec_ModelVariables].from) errors = validateVariables(md);
+
+    if (errors > 0) {
+        logThis(ERROR_ERROR, "Found %d error in file %s", errors, xmlPath);
+        return NULL;
+    }
+    return md;
+}
+
+int XmlParser::validateVariables(ModelDescription *md) {
+    int errors = 0;
+    for (ScalarVariableList::const_iterator it = md->modelVariables.begin(); it != md->modelVariables.end(); ++it) {
         const char *varName = (*it)->getAttributeValue(XmlParser::att_name);
         if (!varName) {
             logThis(ERROR_ERROR, "Scalar variable miss required %s attribute in modelDescription.xml",
@@ -271,12 +865,7 @@ ModelDescription *XmlParser::validate(ModelDescription *md) {
             }
         }
     }
-
-    if (errors > 0) {
-        logThis(ERROR_ERROR, "Found %d error in file %s", errors, xmlPath);
-        return NULL;
-    }
-    return md;
+    return errors;
 }
 
 // #define TEST
@@ -289,7 +878,7 @@ int main() {
     ModelDescription *md = parser->parse();
     if (md) md->printElement(0);
     delete parser;
-    if (md) delete md;
+    if (md) delete md->arena;
 
     dumpMemoryLeaks();
     return 0;
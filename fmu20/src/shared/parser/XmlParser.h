@@ -6,7 +6,10 @@
  * XmlParser.h
  * Parser for xml model description file of a FMI 2.0 model.
  * The result of parsing is a ModelDescription object that can be queried to
- * get necessary information. The parsing is based on libxml2.lib.
+ * get necessary information. The parsing is based on libxml2.lib, or on
+ * XmlTokenizer, which reads the file mapped into memory without copying.
+ * XmlParser::stream reads the file without building a ModelDescription and
+ * passes its elements one by one to an XmlStreamHandler instead.
  *
  * Author: Adrian Tirea
  * ---------------------------------------------------------------------------*/
@@ -15,6 +18,7 @@
 #define XML_PARSER_H
 
 #include <libxml/xmlreader.h>
+#include "XmlArena.h"
 
 #ifdef _MSC_VER
 #pragma comment(lib, "libxml2.lib")
@@ -28,6 +32,8 @@ typedef unsigned int fmi2ValueReference;
 
 class Element;
 class ModelDescription;
+class XmlTokenizer;
+class XmlStreamHandler;
 
 class XmlParser {
  public:
@@ -80,6 +86,12 @@ class XmlParser {
         enu_approx, enu_calculated
     };
 
+    // Sections of the model description whose content is parsed on first access, see setLazy
+    static const int SIZEOF_SEC = 4;
+    enum Sec {
+        sec_UnitDefinitions, sec_VendorAnnotations, sec_ModelVariables, sec_ModelStructure
+    };
+
     // Possible results when retrieving an attribute value from an element
     enum ValueStatus {
         valueMissing,
@@ -89,9 +101,17 @@ class XmlParser {
 
  private:
     char *xmlPath;
+    bool tokenize;               // read with tokenizer instead of xmlReader
     xmlTextReaderPtr xmlReader;
+    XmlTokenizer *tokenizer;
+    Arena *arena;  // of the model description being parsed, owned by the parser until parse succeeds
+    int threads;   // that build the ScalarVariables, see parseModelVariables
+    bool lazy;     // record the range of the sections instead of parsing them, see setLazy
 
  public:
+    // ScalarVariables of a range of ModelVariables, built on a worker thread
+    struct Chunk;
+
     // return the type of this element. Int value match the index in elmNames.
     // throw XmlParserException if element is invalid.
     static XmlParser::Elm checkElement(const char* elm);
@@ -103,23 +123,101 @@ class XmlParser {
     static XmlParser::Enu checkEnumValue(const char* enu);
 
     explicit XmlParser(char *xmlPath);
+    // parse with XmlTokenizer if tokenize is true, see XmlTokenizer.h for its limits
+    XmlParser(char *xmlPath, bool tokenize);
     ~XmlParser();
-    // return NULL on errors. Caller must free the result if not NULL.
+    // Build the ScalarVariables on up to the given number of threads, 0 for one per
+    // processor. Only used with the tokenizer. The default is 1.
+    void setThreads(int threads);
+    // number of processors available, at least 1
+    static int processorCount();
+    // With the tokenizer, only record the range of the content of the sections in Sec, which
+    // is parsed by parseSection on first access. The model variables are checked then.
+    // The default is false.
+    void setLazy(bool lazy);
+    // parse the content of a lazy section of md if not yet done, see setLazy. Errors are
+    // logged and leave the section empty. Not thread-safe.
+    static void parseSection(ModelDescription *md, XmlParser::Sec section);
+    // return NULL on errors. Caller must free the result if not NULL, using freeModelDescription.
     ModelDescription *parse();
+    // Read the model description and pass its elements to the handler in document order
+    // instead of building a ModelDescription: the fmiModelDescription with its attributes
+    // only, ModelExchange, CoSimulation, DefaultExperiment and each Unit, SimpleType,
+    // Category, ScalarVariable and Unknown with their children. The elements are created in
+    // the arena of the parser, which is cleared when the handler returns, so memory does
+    // not grow with the size of the model description if read with the xmlReader. The
+    // VendorAnnotations are skipped and the model description is not validated. Returns
+    // false on errors, which are logged, and true otherwise, also if the handler stopped.
+    bool stream(XmlStreamHandler *handler);
+
+    // create an element of class T in the arena of the model description.
+    // T has a constructor that takes the arena.
+    template <typename T> T *newElement(XmlParser::Elm type) {
+        T *element = new (arena->allocate(sizeof(T))) T(arena);
+        element->type = type;
+        return element;
+    }
+    // create an empty list of type L, a std::vector with ArenaAllocator, in the arena of the
+    // model description
+    template <typename L> L *newList() {
+        return new (arena->allocate(sizeof(L))) L(typename L::allocator_type(arena));
+    }
 
     // throw XmlParserException if attribute invalid.
     void parseElementAttributes(Element *element);
     void parseChildElements(Element *el);
+    // parse the ScalarVariables inside ModelVariables into md, in parallel if enabled
+    // by setThreads and worth it
+    void parseModelVariables(ModelDescription *md);
+    // parse the content of the current element, section of md, into el. With setLazy only
+    // record the range of the content in md.
+    void parseSectionContent(ModelDescription *md, Element *el, XmlParser::Sec section);
     void parseEndElement();
     void parseSkipChildElement();
 
  private:
+    // parse the current element, a child of el
+    void parseChildElement(Element *el);
+    // parse all elements up to the end of a fragment as children of el
+    void parseFragment(Element *el);
+    // stream the children of the current element of type parent, see stream. Returns false
+    // if the handler stopped.
+    bool streamChildren(XmlStreamHandler *handler, XmlParser::Elm parent);
+    // create the current element with its children, pass it to the handler and clear the
+    // arena. Returns false if the handler stopped.
+    bool streamElement(XmlStreamHandler *handler, XmlParser::Elm type, XmlParser::Elm parent);
+    // move to the end of the current element, which is not empty, skipping its content
+    void skipElement();
     // advance reading in xml and skip comments if present.
     bool readNextInXml();
+    // properties of the current node of the xml reader or the tokenizer
+    bool isElementNode();
+    bool isEndElementNode();
+    const char *localName();
+    int isEmptyElement();  // -1 on error
+    int depth();
+    // read the next attribute of the current element. Returns false if there is none.
+    // The value is a copy in the arena, or in place with the tokenizer.
+    bool readNextAttribute(const char **name, char **value);
 
     // check some properties of model description (i.e. each variable has valueReference, ...)
     // if valid return the input model description, else return NULL.
     ModelDescription *validate(ModelDescription *md);
+    // check the model variables of md, returns the number of errors logged
+    int validateVariables(ModelDescription *md);
+};
+
+// Receives the elements read by XmlParser::stream. An element and its children are only
+// valid during the call of element.
+class XmlStreamHandler {
+ public:
+    virtual ~XmlStreamHandler() {}
+    // Returns false for a type of element that is not needed, elements of this type are
+    // skipped without creating them.
+    virtual bool wants(XmlParser::Elm type) = 0;
+    // called for each element of a type wanted, with the type of its parent element, e.g.
+    // elm_Outputs for an Unknown. Returns false to stop reading.
+    virtual bool element(Element *element, XmlParser::Elm parent) = 0;
 };
 
 #endif  // XML_PARSER_H
@@ -11,6 +11,7 @@
 #include "XmlParserCApi.h"
 #include "XmlParser.h"
 #include "XmlElement.h"
+#include "XmlCache.h"
 
 #ifdef STANDALONE_XML_PARSER
 #define logThis(n, ...) printf(__VA_ARGS__); printf("\n")
@@ -20,19 +21,98 @@
 #endif  // STANDALONE_XML_PARSER
 
 ModelDescription* parse(char* xmlPath) {
-    XmlParser parser(xmlPath);
+    return parseWithReader(xmlPath, readerLibxml2);
+}
+ModelDescription* parseWithReader(char* xmlPath, XmlReader reader) {
+    XmlParser parser(xmlPath, reader != readerLibxml2);
+    if (reader == readerParallel) parser.setThreads(0);
+    parser.setLazy(reader == readerLazy);
     return parser.parse();
 }
+ModelDescription* parseCached(char* xmlPath, const char* cachePath, XmlReader reader, int* loaded) {
+    unsigned long long xmlHash = 0;
+    ModelDescription *md = loadModelDescriptionCache(xmlPath, cachePath, &xmlHash);
+    if (loaded) *loaded = md != NULL;
+    if (md) return md;
+    md = parseWithReader(xmlPath, reader);
+    if (md && reader != readerLazy) writeModelDescriptionCache(md, cachePath, xmlHash);
+    return md;
+}
+
+// passes the elements of XmlParser::stream to the callbacks of streamModelDescription
+class CallbackHandler : public XmlStreamHandler {
+ private:
+    const ModelDescriptionCallbacks *callbacks;
+    void *context;
+    int variables;  // passed so far
+
+ public:
+    CallbackHandler(const ModelDescriptionCallbacks *callbacks, void *context)
+        : callbacks(callbacks), context(context), variables(0) {}
+    bool wants(XmlParser::Elm type) {
+        switch (type) {
+            case XmlParser::elm_fmiModelDescription: return callbacks->onModel != NULL;
+            case XmlParser::elm_ModelExchange:
+            case XmlParser::elm_CoSimulation: return callbacks->onComponent != NULL;
+            case XmlParser::elm_Unit: return callbacks->onUnit != NULL;
+            case XmlParser::elm_SimpleType: return callbacks->onType != NULL;
+            case XmlParser::elm_Category: return callbacks->onCategory != NULL;
+            case XmlParser::elm_DefaultExperiment: return callbacks->onDefaultExperiment != NULL;
+            case XmlParser::elm_ScalarVariable: return callbacks->onVariable != NULL;
+            case XmlParser::elm_Unknown: return callbacks->onUnknown != NULL;
+            default: return false;
+        }
+    }
+    bool element(Element *element, XmlParser::Elm parent) {
+        switch (element->type) {
+            case XmlParser::elm_fmiModelDescription:
+                return callbacks->onModel(context, (ModelDescription *)element) != 0;
+            case XmlParser::elm_ModelExchange:
+            case XmlParser::elm_CoSimulation:
+                return callbacks->onComponent(context, (Component *)element) != 0;
+            case XmlParser::elm_Unit:
+                return callbacks->onUnit(context, (Unit *)element) != 0;
+            case XmlParser::elm_SimpleType:
+                return callbacks->onType(context, (SimpleType *)element) != 0;
+            case XmlParser::elm_Category:
+                return callbacks->onCategory(context, element) != 0;
+            case XmlParser::elm_DefaultExperiment:
+                return callbacks->onDefaultExperiment(context, element) != 0;
+            case XmlParser::elm_ScalarVariable:
+                return callbacks->onVariable(context, (ScalarVariable *)element, ++variables) != 0;
+            case XmlParser::elm_Unknown:
+                return callbacks->onUnknown(context, (Elm)parent, element) != 0;
+            default:
+                return true;
+        }
+    }
+};
+
+int streamModelDescription(char *xmlPath, const ModelDescriptionCallbacks *callbacks, void *context) {
+    XmlParser parser(xmlPath);
+    CallbackHandler handler(callbacks, context);
+    return parser.stream(&handler) ? 1 : 0;
+}
+
 void freeModelDescription(ModelDescription *md) {
-    if (md) delete md;
+    // all elements and their attributes are in the arena, the attribute values
+    // of a model description loaded from the cache or read by the tokenizer
+    // are in the mapped file
+    if (md) {
+        MappedFile *mappedFile = md->mappedFile;
+        delete md->arena;
+        delete mappedFile;
+    }
 }
 
 /* ModelDescription fields access*/
 int getUnitDefinitionsSize(ModelDescription *md) {
+    XmlParser::parseSection(md, XmlParser::sec_UnitDefinitions);
     return md->unitDefinitions.size();
 }
 
 Unit *getUnitDefinition(ModelDescription *md, int index) {
+    XmlParser::parseSection(md, XmlParser::sec_UnitDefinitions);
     return md->unitDefinitions.at(index);
 }
 
@@ -65,22 +145,27 @@ Element *getDefaultExperiment(ModelDescription *md) {
 }
 
 int getVendorAnnotationsSize(ModelDescription *md) {
+    XmlParser::parseSection(md, XmlParser::sec_VendorAnnotations);
     return md->vendorAnnotations.size();
 }
 
 Element *getVendorAnnotation(ModelDescription *md, int index) {
+    XmlParser::parseSection(md, XmlParser::sec_VendorAnnotations);
     return md->vendorAnnotations.at(index);
 }
 
 int getScalarVariableSize(ModelDescription *md) {
+    XmlParser::parseSection(md, XmlParser::sec_ModelVariables);
     return md->modelVariables.size();
 }
 
 ScalarVariable *getScalarVariable(ModelDescription *md, int index) {
+    XmlParser::parseSection(md, XmlParser::sec_ModelVariables);
     return md->modelVariables.at(index);
 }
 
 ModelStructure  *getModelStructure (ModelDescription *md) {
+    XmlParser::parseSection(md, XmlParser::sec_ModelStructure);
     return md->modelStructure;
 }
 
@@ -89,9 +174,15 @@ SimpleType *getSimpleType(ModelDescription *md, const char *name) {
 }
 
 ScalarVariable *getVariable(ModelDescription *md, const char *name) {
+    XmlParser::parseSection(md, XmlParser::sec_ModelVariables);
     return md->getVariable(name);
 }
 
+ScalarVariable *getVariableByValueReference(ModelDescription *md, Elm type, fmi2ValueReference vr) {
+    XmlParser::parseSection(md, XmlParser::sec_ModelVariables);
+    return md->getVariable((XmlParser::Elm)type, vr);
+}
+
 const char *getDescriptionForVariable(ModelDescription *md, ScalarVariable *sv) {
     return md->getDescriptionForVariable(sv);
 }
@@ -129,17 +220,29 @@ Element *getInitialUnknown(ModelStructure *ms, int index) {
     return ms->initialUnknowns.at(index);
 }
 
+int getDependencyGraph(ModelStructure *ms, Elm list, DependencyGraph *graph) {
+    Dependencies *d = ms->getDependencies((XmlParser::Elm)list);
+    if (!d) return 0;
+    graph->rows = d->rows;
+    graph->unknowns = d->unknowns;
+    graph->rowStart = d->rowStart;
+    graph->columns = d->columns;
+    graph->kinds = d->kinds;
+    graph->dependsOnAll = d->dependsOnAll;
+    return 1;
+}
+
 /* ScalarVariable field access */
 Element *getTypeSpec(ScalarVariable *sv) {
     return sv->typeSpec;
 }
 
 int getAnnotationsSize(ScalarVariable *sv) {
-    return sv->annotations.size();
+    return sv->annotations ? sv->annotations->size() : 0;
 }
 
 Element *getAnnotation(ScalarVariable *sv, int index) {
-    return sv->annotations.at(index);
+    return sv->annotations ? sv->annotations->at(index) : NULL;
 }
 
 fmi2ValueReference getValueReference(ScalarVariable *sv) {
@@ -204,7 +307,7 @@ const char *getElementTypeName(Element *el) {
 }
 
 const char **getAttributesAsArray(Element *el, int *n) {
-    *n = el->attributes.size();
+    *n = el->getAttributeCount();
     const char **result = (const char **)calloc(2 * (*n), sizeof(char *));
     if (!result) {
         logThis(ERROR_FATAL, "Out of memory");
@@ -212,10 +315,12 @@ const char **getAttributesAsArray(Element *el, int *n) {
         return NULL;
     }
     int i = 0;
-    for (std::map<XmlParser::Att, char *>::iterator it = el->attributes.begin(); it != el->attributes.end(); ++it ) {
-        result[i] = (const char*)XmlParser::attNames[it->first];
-        result[i + 1] = it->second;
-        i = i + 2;
+    for (int att = 0; att < XmlParser::SIZEOF_ATT; att++) {
+        if (el->attributeMask & (1ULL << att)) {
+            result[i] = (const char*)XmlParser::attNames[att];
+            result[i + 1] = el->attributeValues[i / 2];
+            i = i + 2;
+        }
     }
     return result;
 }
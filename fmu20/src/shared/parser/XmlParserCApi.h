@@ -74,13 +74,58 @@ typedef enum {
     valueIllegal
 } ValueStatus;
 
+// Readers of the xml file
+typedef enum {
+    readerLibxml2,   // xmlTextReader of libxml2
+    readerTokenizer, // XmlTokenizer, faster, for UTF-8 files without DOCTYPE, see XmlTokenizer.h
+    readerParallel,  // XmlTokenizer, the ScalarVariables are built on one thread per processor
+    readerLazy       // XmlTokenizer, the UnitDefinitions, VendorAnnotations, ModelVariables and
+                     // ModelStructure are parsed on first access by the functions below
+} XmlReader;
+
 // Returns NULL to indicate failure
 // Otherwise, return the root node md of the AST. From the result of this
 // function user can access all other elements from ModelDescription.xml.
 // The receiver must call freeModelDescription(md) to release AST memory.
 ModelDescription* parse(char* xmlPath);
+// same as parse, reading the xml file with the given reader. Errors in the lazy sections
+// of readerLazy are logged on first access and leave the section empty.
+ModelDescription* parseWithReader(char* xmlPath, XmlReader reader);
+// same as parseWithReader, but loads the cache file cachePath instead of parsing the xml
+// file if the cache was made from the current content of the file, and writes the cache
+// otherwise, see XmlCache.h. A model description read with readerLazy is not written to
+// the cache. Sets *loaded, unless loaded is NULL, to 1 if the cache was loaded, else to 0.
+ModelDescription* parseCached(char* xmlPath, const char* cachePath, XmlReader reader, int* loaded);
 void freeModelDescription(ModelDescription *md);
 
+// Callbacks of streamModelDescription, NULL for elements that are not needed. Each gets
+// the context passed to streamModelDescription and an element that is only valid during
+// the call, it is released with its children when the callback returns. The functions
+// below get its attributes, typed values included, and children; those that need the
+// model description, like getDescriptionForVariable or the lookups, cannot be used.
+// A callback returns 0 to stop reading, any other value to continue.
+typedef struct {
+    // fmiModelDescription with its attributes, it has no children
+    int (*onModel)(void *context, ModelDescription *md);
+    // ModelExchange or CoSimulation
+    int (*onComponent)(void *context, Component *component);
+    int (*onUnit)(void *context, Unit *unit);
+    int (*onType)(void *context, SimpleType *type);
+    int (*onCategory)(void *context, Element *category);
+    int (*onDefaultExperiment)(void *context, Element *defaultExperiment);
+    // index of the variable, starting at 1, as used by the Unknowns
+    int (*onVariable)(void *context, ScalarVariable *sv, int index);
+    // list is the list holding the Unknown: elm_Outputs, elm_Derivatives, elm_DiscreteStates
+    // or elm_InitialUnknowns
+    int (*onUnknown)(void *context, Elm list, Element *unknown);
+} ModelDescriptionCallbacks;
+// Read the xml model description file with the xmlTextReader of libxml2 and pass its
+// elements to the callbacks in document order, without building a ModelDescription, so
+// memory use does not grow with the size of the file. The VendorAnnotations are skipped,
+// the file is not validated and the cache is not used. Returns 0 on errors, which are
+// logged, and 1 otherwise, also if a callback stopped the reading.
+int streamModelDescription(char *xmlPath, const ModelDescriptionCallbacks *callbacks, void *context);
+
 
 /* ModelDescription functions */
 // get number of unit definitions
@@ -116,6 +161,10 @@ ModelStructure  *getModelStructure (ModelDescription *md);
 SimpleType *getSimpleType(ModelDescription *md, const char *name);
 // get the ScalarVariable by name, if any. NULL if not found.
 ScalarVariable *getVariable(ModelDescription *md, const char *name);
+// get the first ScalarVariable with a typeSpec of the given type, one of elm_Real, elm_Integer,
+// elm_Boolean, elm_String, elm_Enumeration, and the given valueReference, if any. NULL if not found.
+// These lookups use hash indexes built by parse.
+ScalarVariable *getVariableByValueReference(ModelDescription *md, Elm type, fmi2ValueReference vr);
 // get description from variable, if not present look for type definition description.
 const char *getDescriptionForVariable(ModelDescription *md, ScalarVariable *sv);
 
@@ -137,6 +186,27 @@ int getInitialUnknownsSize(ModelStructure *ms);
 // get initial unknown at index
 Element *getInitialUnknown(ModelStructure *ms, int index);
 
+// Dependencies of the Unknowns of a list of the model structure in compressed sparse row
+// form, parsed from their dependencies and dependenciesKind attributes by parse.
+// Row i is the Unknown at index i of the list, it depends on the variables
+// columns[rowStart[i]] .. columns[rowStart[i + 1] - 1] with the kinds at the same
+// positions in kinds. Variables are given by their index, starting at 1, as in the xml.
+// A dependency that is not a number is left out. A row without dependencies attribute
+// has no columns and may depend on all knowns, see the FMI 2.0 specification.
+typedef struct {
+    int rows;                  // number of Unknowns
+    const int *unknowns;       // index of the variable of each row, 0 if missing or illegal
+    const int *rowStart;       // rows + 1 offsets into columns and kinds
+    const int *columns;        // index of the variable of each dependency
+    const signed char *kinds;  // Enu of each dependency: dependent, constant, fixed, tunable or
+                               // discrete, dependent if dependenciesKind is missing, and
+                               // enu_BAD_DEFINED for an unknown or missing kind
+    const char *dependsOnAll;  // of each row, 1 if it has no dependencies attribute
+} DependencyGraph;
+// set graph to the dependencies of list, one of elm_Outputs, elm_Derivatives, elm_DiscreteStates,
+// elm_InitialUnknowns. The arrays belong to the model description. Returns 0 for other lists.
+int getDependencyGraph(ModelStructure *ms, Elm list, DependencyGraph *graph);
+
 /* ScalarVariable functions */
 // one of Real, Integer, etc.
 Element *getTypeSpec(ScalarVariable *sv);
@@ -0,0 +1,407 @@
+/*
+ * Copyright QTronic GmbH. All rights reserved.
+ */
+
+/* ---------------------------------------------------------------------------*
+ * XmlTokenizer.cpp
+ * Tokenizer for the xml model description file, see XmlTokenizer.h.
+ * ---------------------------------------------------------------------------*/
+
+#include "XmlTokenizer.h"
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include "XmlParserException.h"
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Returns the first occurrence of s in [from, end), or NULL
+static char *findString(char *from, char *end, const char *s) {
+    size_t n = strlen(s);
+    while ((size_t)(end - from) >= n) {
+        char *q = (char *)memchr(from, s[0], end - from - n + 1);
+        if (!q) return NULL;
+        if (!memcmp(q, s, n)) return q;
+        from = q + 1;
+    }
+    return NULL;
+}
+
+// Returns true if [s, end) equals the nul terminated name, ignoring case
+static bool equalsIgnoreCase(const char *s, const char *end, const char *name) {
+    for (; s < end && *name; s++, name++) {
+        if (tolower((unsigned char)*s) != tolower((unsigned char)*name)) return false;
+    }
+    return s == end && !*name;
+}
+
+// Writes the UTF-8 encoding of the code point to w. Returns the end of the encoding.
+static char *encodeUtf8(char *w, unsigned long code) {
+    if (code < 0x80) {
+        *w++ = (char)code;
+    } else if (code < 0x800) {
+        *w++ = (char)(0xC0 | (code >> 6));
+        *w++ = (char)(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        *w++ = (char)(0xE0 | (code >> 12));
+        *w++ = (char)(0x80 | ((code >> 6) & 0x3F));
+        *w++ = (char)(0x80 | (code & 0x3F));
+    } else {
+        *w++ = (char)(0xF0 | (code >> 18));
+        *w++ = (char)(0x80 | ((code >> 12) & 0x3F));
+        *w++ = (char)(0x80 | ((code >> 6) & 0x3F));
+        *w++ = (char)(0x80 | (code & 0x3F));
+    }
+    return w;
+}
+
+XmlTokenizer::XmlTokenizer(const char *xmlPath, char *data, size_t size, Arena *arena)
+    : xmlPath(xmlPath), arena(arena), start(data), startLine(1), p(data), end(data + size),
+      type(nodeNone), name(NULL), emptyElement(false), nodeDepth(0), rootDone(false), fragment(false),
+      errorAt(NULL), errorMessage(NULL), nextAttribute(0) {
+    // skip the byte order mark of UTF-8
+    if (size >= 3 && !memcmp(data, "\xEF\xBB\xBF", 3)) p += 3;
+    else if (size >= 2 && (!data[0] || !data[1])) error(p, "UTF-16 and UTF-32 are not supported");
+}
+
+XmlTokenizer::XmlTokenizer(const char *xmlPath, char *start, int startLine, char *from, char *to, Arena *arena)
+    : xmlPath(xmlPath), arena(arena), start(start), startLine(startLine), p(from), end(to), type(nodeNone), name(NULL), emptyElement(false), nodeDepth(0), rootDone(false), fragment(true),
+      errorAt(NULL), errorMessage(NULL), nextAttribute(0) {
+}
+
+void XmlTokenizer::error(const char *at, const char *message) {
+    if (fragment) {
+        errorAt = at;
+        errorMessage = message;
+        throw XmlParserException("Error parsing xml file '%s': %s", xmlPath, message);
+    }
+    throw XmlParserException("Error parsing xml file '%s' at line %d: %s", xmlPath, lineNumber(at), message);
+}
+
+int XmlTokenizer::lineNumber(const char *at) const {
+    int line = startLine;
+    for (const char *q = start; q < at && q < end; q++) {
+        if (*q == '\n') line++;
+    }
+    return line;
+}
+
+bool XmlTokenizer::read() {
+    attributes.clear();
+    nextAttribute = 0;
+    for (;;) {
+        char *lt = (char *)memchr(p, '<', end - p);
+        if (openElements.empty() && !fragment) {
+            // outside of the root element only white space is allowed
+            for (char *q = p; q < (lt ? lt : end); q++) {
+                if (!isSpace(*q)) error(q, "Content outside of the root element");
+            }
+        }
+        if (!lt) {
+            if (!openElements.empty()) error(end, "Premature end of data");
+            if (!rootDone && !fragment) error(end, "Root element missing");
+            p = end;
+            type = nodeNone;
+            return false;
+        }
+        p = lt;
+        if (p + 1 >= end) error(p, "Premature end of data");
+        if (p[1] == '/') {
+            readEndTag();
+            return true;
+        } else if (p[1] == '?') {
+            readDeclaration();
+        } else if (p[1] == '!') {
+            char *q;
+            if (end - p >= 4 && !memcmp(p, "<!--", 4)) {
+                q = findString(p + 4, end, "-->");
+                if (!q) error(p, "Comment not terminated");
+                p = q + 3;
+            } else if (end - p >= 9 && !memcmp(p, "<![CDATA[", 9)) {
+                if (openElements.empty() && !fragment) error(p, "CDATA section outside of the root element");
+                q = findString(p + 9, end, "]]>");
+                if (!q) error(p, "CDATA section not terminated");
+                p = q + 3;
+            } else {
+                error(p, "Document type declarations are not supported");
+            }
+        } else {
+            readStartTag();
+            return true;
+        }
+    }
+}
+
+void XmlTokenizer::readStartTag() {
+    char *q = p + 1;
+    char *nameEnd;
+    if (rootDone) error(p, "Extra content at the end of the document");
+    name = q;
+    while (q < end && !isSpace(*q) && *q != '/' && *q != '>') q++;
+    if (q == name) error(q, "Element name expected");
+    nameEnd = q;
+    for (;;) {
+        char *separator = q;
+        char *attName;
+        char *attNameEnd;
+        char *value;
+        char *valueEnd;
+        while (q < end && isSpace(*q)) q++;
+        if (q >= end) error(q, "Premature end of data in tag");
+        if (*q == '>') {
+            q++;
+            emptyElement = false;
+            break;
+        }
+        if (*q == '/') {
+            if (q + 1 >= end || q[1] != '>') error(q, "'>' expected");
+            q += 2;
+            emptyElement = true;
+            break;
+        }
+        if (q == separator) error(q, "White space expected before attribute");
+        attName = q;
+        while (q < end && !isSpace(*q) && *q != '=' && *q != '/' && *q != '>') q++;
+        if (q == attName) error(q, "Attribute name expected");
+        attNameEnd = q;
+        while (q < end && isSpace(*q)) q++;
+        if (q >= end || *q != '=') error(q, "'=' expected after attribute name");
+        q++;
+        while (q < end && isSpace(*q)) q++;
+        if (q >= end || (*q != '"' && *q != '\'')) error(q, "Quoted attribute value expected");
+        value = q + 1;
+        valueEnd = (char *)memchr(value, *q, end - value);
+        if (!valueEnd) error(q, "Attribute value not terminated");
+        q = valueEnd + 1;
+        // terminate name and value in place, the characters replaced have been read
+        *attNameEnd = '\0';
+        *decodeValue(value, valueEnd) = '\0';
+        attributes.push_back(attName);
+        attributes.push_back(value);
+    }
+    *nameEnd = '\0';
+    p = q;
+    type = nodeElement;
+    nodeDepth = (int)openElements.size();
+    if (!emptyElement) {
+        openElements.push_back(name);
+    } else if (openElements.empty() && !fragment) {
+        rootDone = true;
+    }
+}
+
+void XmlTokenizer::readEndTag() {
+    char *q = p + 2;
+    char *tagName = q;
+    size_t n;
+    while (q < end && !isSpace(*q) && *q != '>') q++;
+    n = q - tagName;
+    while (q < end && isSpace(*q)) q++;
+    if (q >= end || *q != '>') error(q, "'>' expected");
+    if (openElements.empty()) error(p, "End tag without start tag");
+    name = openElements.back();
+    if (strncmp(name, tagName, n) || name[n]) error(p, "Opening and ending tag mismatch");
+    openElements.pop_back();
+    p = q + 1;
+    type = nodeEndElement;
+    emptyElement = false;
+    nodeDepth = (int)openElements.size();
+    if (openElements.empty() && !fragment) rootDone = true;
+}
+
+bool XmlTokenizer::fragmentError(const char **at, const char **message) const {
+    if (!errorAt) return false;
+    *at = errorAt;
+    *message = errorMessage;
+    return true;
+}
+
+// Only the structure is checked: tags, quotes, comments and CDATA sections.
+// Nothing is written to the buffer, the fragments do that.
+bool XmlTokenizer::scanChildren(const char *childName, std::vector<char *> *children, char **endTag) {
+    size_t childNameLength = childName ? strlen(childName) : 0;
+    int d = 0;  // depth relative to the children
+    char *q = p;
+    if (type != nodeElement || emptyElement) return false;
+    for (;;) {
+        char *lt = (char *)memchr(q, '<', end - q);
+        if (!lt || lt + 1 >= end) return false;
+        q = lt + 1;
+        if (*q == '/') {
+            if (d == 0) {
+                // the end tag of the current element, or a mismatch read has to report
+                size_t n = strlen(name);
+                if ((size_t)(end - q - 1) < n || memcmp(q + 1, name, n)
+                        || (q + 1 + n < end && !isSpace(q[1 + n]) && q[1 + n] != '>')) {
+                    return false;
+                }
+                *endTag = lt;
+                return true;
+            }
+            d--;
+            q = (char *)memchr(q, '>', end - q);
+            if (!q) return false;
+        } else if (*q == '?') {
+            q = findString(q, end, "?>");
+            if (!q) return false;
+        } else if (*q == '!') {
+            if (end - lt >= 4 && !memcmp(lt, "<!--", 4)) {
+                q = findString(lt + 4, end, "-->");
+            } else if (end - lt >= 9 && !memcmp(lt, "<![CDATA[", 9)) {
+                q = findString(lt + 9, end, "]]>");
+            } else {
+                return false;
+            }
+            if (!q) return false;
+        } else {
+            if (d == 0) {
+                // compare the local name
+                char *nameEnd = q;
+                char *local = q;
+                while (nameEnd < end && !isSpace(*nameEnd) && *nameEnd != '/' && *nameEnd != '>') {
+                    if (*nameEnd == ':') local = nameEnd + 1;
+                    nameEnd++;
+                }
+                if (childName && ((size_t)(nameEnd - local) != childNameLength
+                        || memcmp(local, childName, childNameLength))) {
+                    return false;
+                }
+                if (children) children->push_back(lt);
+                q = nameEnd;
+            }
+            // find the end of the tag, '>' may appear in attribute values
+            while (q < end && *q != '>') {
+                if (*q == '"' || *q == '\'') {
+                    q = (char *)memchr(q + 1, *q, end - q - 1);
+                    if (!q) return false;
+                }
+                q++;
+            }
+            if (q >= end) return false;
+            if (q[-1] != '/') d++;
+        }
+    }
+}
+
+// skip a processing instruction, check the encoding if it is the xml declaration
+void XmlTokenizer::readDeclaration() {
+    char *q = findString(p + 2, end, "?>");
+    if (!q) error(p, "Processing instruction not terminated");
+    if (q - p >= 6 && !memcmp(p, "<?xml", 5) && isSpace(p[5])) {
+        char *e = findString(p + 5, q, "encoding");
+        if (e) {
+            char *value;
+            e += 8;
+            while (e < q && isSpace(*e)) e++;
+            if (e < q && *e == '=') e++;
+            while (e < q && isSpace(*e)) e++;
+            if (e >= q || (*e != '"' && *e != '\'')) error(e, "Quoted encoding expected");
+            value = e + 1;
+            e = (char *)memchr(value, *e, q - value);
+            if (!e) error(value, "Encoding not terminated");
+            if (equalsIgnoreCase(value, e, "ISO-8859-1") || equalsIgnoreCase(value, e, "latin1")) {
+                p = q + 2;
+                convertLatin1();
+                return;
+            }
+            if (!equalsIgnoreCase(value, e, "UTF-8") && !equalsIgnoreCase(value, e, "US-ASCII")
+                    && !equalsIgnoreCase(value, e, "ASCII")) {
+                error(value, "Encodings other than UTF-8, ASCII and ISO-8859-1 are not supported");
+            }
+        }
+    }
+    p = q + 2;
+}
+
+// convert the rest of the buffer from ISO-8859-1 to UTF-8 into the arena, unless it is ASCII
+void XmlTokenizer::convertLatin1() {
+    size_t n = 0;
+    char *q;
+    char *w;
+    for (q = p; q < end; q++) {
+        if (*q & 0x80) n++;
+    }
+    if (n == 0) return;
+    for (q = start; q < p; q++) {
+        if (*q == '\n') startLine++;
+    }
+    w = (char *)arena->allocate(end - p + n);
+    start = w;
+    for (q = p; q < end; q++) w = encodeUtf8(w, (unsigned char)*q);
+    p = start;
+    end = w;
+}
+
+// Decode the references and normalize the white space of the attribute value in
+// [value, valueEnd) in place, see section 3.3.3 of the XML specification.
+// Returns the end of the decoded value. A reference is never shorter than its value.
+char *XmlTokenizer::decodeValue(char *value, char *valueEnd) {
+    char *r = value;
+    char *w;
+    while (r < valueEnd && *r != '&' && *r != '<' && *r != '\t' && *r != '\n' && *r != '\r') r++;
+    w = r;
+    while (r < valueEnd) {
+        char c = *r++;
+        if (c == '<') {
+            error(r - 1, "'<' in attribute value");
+        } else if (c == '\t' || c == '\n') {
+            c = ' ';
+        } else if (c == '\r') {
+            c = ' ';
+            if (r < valueEnd && *r == '\n') r++;
+        } else if (c == '&') {
+            char *semicolon = (char *)memchr(r, ';', valueEnd - r);
+            size_t n;
+            if (!semicolon) error(r - 1, "';' expected after reference");
+            n = semicolon - r;
+            if (n > 1 && r[0] == '#') {
+                unsigned long code = 0;
+                int base = r[1] == 'x' ? 16 : 10;
+                char *digit = base == 16 ? r + 2 : r + 1;
+                if (digit == semicolon) error(r - 1, "Character reference without digits");
+                for (; digit < semicolon; digit++) {
+                    int d = isdigit((unsigned char)*digit) ? *digit - '0'
+                            : isxdigit((unsigned char)*digit) ? tolower((unsigned char)*digit) - 'a' + 10 : 99;
+                    if (d >= base) error(r - 1, "Illegal character reference");
+                    code = code * base + d;
+                    if (code > 0x10FFFF) error(r - 1, "Illegal character reference");
+                }
+                if (code == 0) error(r - 1, "Illegal character reference");
+                w = encodeUtf8(w, code);
+                r = semicolon + 1;
+                continue;
+            }
+            if (n == 2 && !memcmp(r, "lt", 2)) c = '<';
+            else if (n == 2 && !memcmp(r, "gt", 2)) c = '>';
+            else if (n == 3 && !memcmp(r, "amp", 3)) c = '&';
+            else if (n == 4 && !memcmp(r, "quot", 4)) c = '"';
+            else if (n == 4 && !memcmp(r, "apos", 4)) c = '\'';
+            else error(r - 1, "Undefined entity");
+            r = semicolon + 1;
+        }
+        *w++ = c;
+    }
+    return w;
+}
+
+void XmlTokenizer::skip() {
+    int d = nodeDepth;
+    if (type != nodeElement || emptyElement) return;
+    while (read()) {
+        if (type == nodeEndElement && nodeDepth == d) return;
+    }
+}
+
+const char *XmlTokenizer::localName() const {
+    const char *colon = strrchr(name, ':');
+    return colon ? colon + 1 : name;
+}
+
+bool XmlTokenizer::readAttribute(const char **attName, char **attValue) {
+    if (nextAttribute >= attributes.size()) return false;
+    *attName = attributes[nextAttribute++];
+    *attValue = attributes[nextAttribute++];
+    return true;
+}
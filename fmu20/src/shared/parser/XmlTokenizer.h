@@ -0,0 +1,109 @@
+/*
+ * Copyright QTronic GmbH. All rights reserved.
+ */
+
+/* ---------------------------------------------------------------------------*
+ * XmlTokenizer.h
+ * Tokenizer for the xml model description file, an alternative to the
+ * libxml2 xmlTextReader used by XmlParser. It reads the elements of a file
+ * mapped into memory copy on write and returns the names and attribute
+ * values in place: the character after a name or value is overwritten by
+ * '\0', and entity and character references and white space in attribute
+ * values are decoded in place, which only happens for values that contain
+ * them. Nothing is copied, so the buffer must outlive the model description.
+ *
+ * Only what a model description uses is supported: UTF-8, ASCII or
+ * ISO-8859-1, the predefined entities and character references, comments,
+ * processing instructions and CDATA sections, which are skipped together
+ * with all other text. A file in ISO-8859-1 that is not plain ASCII is
+ * converted to UTF-8 into the arena first. A DOCTYPE or another encoding is
+ * reported as an error, the libxml2 reader has to be used for such files.
+ *
+ * For a parallel or lazy parse, scanChildren locates the child elements
+ * of the current element without reading them, and a fragment tokenizer
+ * reads a range of these children later or on another thread.
+ * ---------------------------------------------------------------------------*/
+
+#ifndef XML_TOKENIZER_H
+#define XML_TOKENIZER_H
+
+#include <cstddef>
+#include <vector>
+#include "XmlArena.h"
+
+class XmlTokenizer {
+ public:
+    enum NodeType { nodeNone, nodeElement, nodeEndElement };
+
+ private:
+    const char *xmlPath;  // for error messages
+    Arena *arena;         // for the conversion of ISO-8859-1 to UTF-8
+    char *start;          // of the buffer
+    int startLine;        // line number of start
+    char *p;              // next character to read
+    char *end;            // end of the buffer
+    NodeType type;        // of the current node
+    const char *name;     // qualified name of the current element
+    bool emptyElement;    // current element is of the form <name/>
+    int nodeDepth;        // depth of the current node, 0 for the root element
+    bool rootDone;        // end of the root element read
+    bool fragment;        // tokenizing a range of the content of an element
+    const char *errorAt;  // position of the error of a fragment, or NULL
+    const char *errorMessage;
+    std::vector<char *> attributes;  // of the current element: name, value, name, value, ...
+    size_t nextAttribute; // index in attributes
+    std::vector<const char *> openElements;  // qualified names of the enclosing elements
+
+    XmlTokenizer(const XmlTokenizer &);
+    XmlTokenizer &operator=(const XmlTokenizer &);
+
+    void readStartTag();
+    void readEndTag();
+    void readDeclaration();
+    void convertLatin1();
+    char *decodeValue(char *value, char *valueEnd);
+
+ public:
+    // tokenize size bytes from data, which is modified
+    XmlTokenizer(const char *xmlPath, char *data, size_t size, Arena *arena);
+    // tokenize the range [from, to) of the content of an element, a sequence of elements and
+    // text, of the document that starts at start with line startLine, see documentStart.
+    // Can be used on another thread than the tokenizer of the document.
+    XmlTokenizer(const char *xmlPath, char *start, int startLine, char *from, char *to, Arena *arena);
+    // Throw XmlParserException with the line number of at. A fragment keeps at and message
+    // for the document instead, see fragmentError, since counting lines would read the
+    // ranges of the other fragments.
+    void error(const char *at, const char *message);
+    // line number of a position in the buffer, counted from the start of the document
+    int lineNumber(const char *at) const;
+    // Returns the error of a fragment, or false if it had none
+    bool fragmentError(const char **at, const char **message) const;
+    // Locate the children of the current element without reading them, which is done by
+    // fragment tokenizers. Append the start of each child to children unless NULL and set
+    // endTag to the end tag of the current element. Returns false if a child is not named
+    // childName, unless NULL, or if the content is not well-formed; read reports the error
+    // when reading the content.
+    bool scanChildren(const char *childName, std::vector<char *> *children, char **endTag);
+    // continue with the end tag of the current element returned by scanChildren
+    void moveToEndTag(char *endTag) { p = endTag; }
+    // next character to read, after the tag of the current node
+    char *position() const { return p; }
+    // start of the document and its line number, for the fragment tokenizers
+    char *documentStart() const { return start; }
+    int documentStartLine() const { return startLine; }
+    // Move to the next element or end of element. Returns false at the end of the document.
+    // Throw XmlParserException if the xml is not well-formed or not supported.
+    bool read();
+    // Move to the end of the current element, skipping its content. Nothing to do for an
+    // empty element. Throw XmlParserException as read.
+    void skip();
+    NodeType nodeType() const { return type; }
+    // name of the current element without namespace prefix
+    const char *localName() const;
+    bool isEmptyElement() const { return emptyElement; }
+    int depth() const { return nodeDepth; }
+    // Get the next attribute of the current element. Returns false if there is none.
+    bool readAttribute(const char **attName, char **attValue);
+};
+
+#endif  // XML_TOKENIZER_H
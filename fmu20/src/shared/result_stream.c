@@ -0,0 +1,244 @@
+/* -------------------------------------------------------------------------
+ * result_stream.c
+ * Buffered, optionally gzip compressed output stream for the result file
+ * of fmusim_me and fmusim_cs. Compression requires zlib and is enabled by
+ * compiling with -DHAVE_ZLIB, see ../Makefile.
+ * Copyright QTronic GmbH. All rights reserved.
+ * -------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#include "result_stream.h"
+
+#define OUT_SIZE (64 * 1024) // size of buffer for compressed data
+
+struct ResultStream {
+    FILE *file;
+    int failed;              // 1 after a write error
+    unsigned char *block;    // data not yet written
+    size_t size;             // number of bytes in block
+    size_t capacity;         // allocated size of block
+    size_t rowSize;          // bytes per row, 0 unless resultStreamBeginRows was called
+    RowTransform transform;  // applied to blocks of rows
+    unsigned char *scratch;  // transformed block of rows
+#ifdef HAVE_ZLIB
+    int compress;            // 1 to compress the output
+    z_stream z;
+    unsigned char *out;      // compressed data
+#endif
+};
+
+int resultStreamCanCompress() {
+#ifdef HAVE_ZLIB
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+ResultStream *resultStreamOpen(const char *path, int level) {
+    ResultStream *rs = (ResultStream *)calloc(1, sizeof(ResultStream));
+    if (!rs) return NULL;
+    if (level > 0 && !resultStreamCanCompress()) {
+        printf("error: Compression of the result file is not supported by this build\n");
+        free(rs);
+        return NULL;
+    }
+    rs->capacity = RESULT_BLOCK_SIZE;
+    rs->block = (unsigned char *)malloc(rs->capacity);
+    if (!rs->block) {
+        free(rs);
+        return NULL;
+    }
+#ifdef HAVE_ZLIB
+    if (level > 0) {
+        rs->out = (unsigned char *)malloc(OUT_SIZE);
+        // windowBits 15 + 16 selects the gzip format
+        if (!rs->out || deflateInit2(&rs->z, level > 9 ? 9 : level, Z_DEFLATED, 15 + 16, 8,
+                Z_DEFAULT_STRATEGY) != Z_OK) {
+            free(rs->out);
+            free(rs->block);
+            free(rs);
+            return NULL;
+        }
+        rs->compress = 1;
+    }
+#endif
+    rs->file = fopen(path, "wb");
+    if (!rs->file) {
+#ifdef HAVE_ZLIB
+        if (rs->compress) deflateEnd(&rs->z);
+        free(rs->out);
+#endif
+        free(rs->block);
+        free(rs);
+        return NULL;
+    }
+    return rs;
+}
+
+// write n bytes to the file, compressed if required.
+// flush is 1 at the end of a block, 2 at the end of the stream.
+static void writeOut(ResultStream *rs, const unsigned char *data, size_t n, int flush) {
+#ifdef HAVE_ZLIB
+    if (rs->compress) {
+        int mode = flush == 2 ? Z_FINISH : (flush ? Z_FULL_FLUSH : Z_NO_FLUSH);
+        rs->z.next_in = (Bytef *)data;
+        rs->z.avail_in = (uInt)n;
+        do {
+            size_t nOut;
+            rs->z.next_out = rs->out;
+            rs->z.avail_out = OUT_SIZE;
+            deflate(&rs->z, mode);
+            nOut = OUT_SIZE - rs->z.avail_out;
+            if (nOut > 0 && fwrite(rs->out, 1, nOut, rs->file) != nOut) rs->failed = 1;
+        } while (rs->z.avail_out == 0);
+        return;
+    }
+#endif
+    if (n > 0 && fwrite(data, 1, n, rs->file) != n) rs->failed = 1;
+}
+
+// transform the rows in block in place, using scratch for the shuffle
+static void transformRows(ResultStream *rs, size_t nRows) {
+    size_t nWords = rs->rowSize / sizeof(double);
+    size_t r, j, b;
+    unsigned char *data = rs->block;
+    if (rs->transform == transformXor || rs->transform == transformXorShuffle) {
+        // from last to first row, so that the previous row is still untransformed
+        for (r = nRows - 1; r > 0; r--) {
+            unsigned char *row = rs->block + r * rs->rowSize;
+            unsigned char *pre = row - rs->rowSize;
+            for (j = 0; j < rs->rowSize; j++) row[j] ^= pre[j];
+        }
+    }
+    if (rs->transform == transformShuffle || rs->transform == transformXorShuffle) {
+        unsigned char *out = rs->scratch;
+        for (j = 0; j < nWords; j++) {
+            for (b = 0; b < sizeof(double); b++) {
+                const unsigned char *in = data + j * sizeof(double) + b;
+                for (r = 0; r < nRows; r++) {
+                    *out++ = in[r * rs->rowSize];
+                }
+            }
+        }
+        memcpy(rs->block, rs->scratch, nRows * rs->rowSize);
+    }
+}
+
+// write the pending data as one block
+static void writeBlock(ResultStream *rs) {
+    if (rs->size == 0) return;
+    if (rs->rowSize) {
+        unsigned int nRows = (unsigned int)(rs->size / rs->rowSize);
+        transformRows(rs, nRows);
+        writeOut(rs, (unsigned char *)&nRows, sizeof(nRows), 0);
+    }
+    writeOut(rs, rs->block, rs->size, 1);
+    rs->size = 0;
+}
+
+void resultStreamWrite(ResultStream *rs, const void *data, size_t n) {
+    const unsigned char *p = (const unsigned char *)data;
+    while (n > 0) {
+        size_t k = rs->capacity - rs->size;
+        if (k == 0) {
+            writeBlock(rs);
+            continue;
+        }
+        if (k > n) k = n;
+        memcpy(rs->block + rs->size, p, k);
+        rs->size += k;
+        p += k;
+        n -= k;
+    }
+}
+
+void resultStreamPrintf(ResultStream *rs, const char *format, ...) {
+    va_list argp;
+    size_t room = rs->capacity - rs->size;
+    int n;
+    va_start(argp, format);
+    n = vsnprintf((char *)rs->block + rs->size, room, format, argp);
+    va_end(argp);
+    if (n < 0) return;
+    if ((size_t)n < room) {
+        rs->size += n;
+        return;
+    }
+    // does not fit into the current block
+    writeBlock(rs);
+    room = rs->capacity;
+    if ((size_t)n < room) {
+        va_start(argp, format);
+        vsnprintf((char *)rs->block, room, format, argp);
+        va_end(argp);
+        rs->size = n;
+    } else {
+        char *text = (char *)malloc(n + 1);
+        if (!text) {
+            rs->failed = 1;
+            return;
+        }
+        va_start(argp, format);
+        vsnprintf(text, n + 1, format, argp);
+        va_end(argp);
+        resultStreamWrite(rs, text, n);
+        free(text);
+    }
+}
+
+void resultStreamBeginRows(ResultStream *rs, int nDoubles, RowTransform transform) {
+    size_t rowSize = nDoubles * sizeof(double);
+    size_t capacity = RESULT_BLOCK_SIZE / rowSize * rowSize;
+    writeBlock(rs);
+    if (capacity == 0) capacity = rowSize;
+    if (capacity != rs->capacity) {
+        unsigned char *block = (unsigned char *)realloc(rs->block, capacity);
+        if (!block) {
+            rs->failed = 1;
+            return;
+        }
+        rs->block = block;
+        rs->capacity = capacity;
+    }
+    if (transform == transformShuffle || transform == transformXorShuffle) {
+        rs->scratch = (unsigned char *)malloc(capacity);
+        if (!rs->scratch) {
+            rs->failed = 1;
+            return;
+        }
+    }
+    rs->rowSize = rowSize;
+    rs->transform = transform;
+}
+
+void resultStreamWriteRow(ResultStream *rs, const double *row) {
+    if (rs->failed) return;
+    if (rs->size + rs->rowSize > rs->capacity) writeBlock(rs);
+    memcpy(rs->block + rs->size, row, rs->rowSize);
+    rs->size += rs->rowSize;
+}
+
+int resultStreamClose(ResultStream *rs) {
+    int ok;
+    writeBlock(rs);
+#ifdef HAVE_ZLIB
+    if (rs->compress) {
+        writeOut(rs, NULL, 0, 2);
+        deflateEnd(&rs->z);
+        free(rs->out);
+    }
+#endif
+    if (fclose(rs->file) != 0) rs->failed = 1;
+    ok = !rs->failed;
+    free(rs->block);
+    free(rs->scratch);
+    free(rs);
+    return ok;
+}
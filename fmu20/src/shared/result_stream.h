@@ -0,0 +1,49 @@
+/* -------------------------------------------------------------------------
+ * result_stream.h
+ * Buffered output stream for the result file of fmusim_me and fmusim_cs.
+ * Data is collected in blocks that are written to the file, optionally
+ * compressed with deflate in gzip format. Each block ends with a full
+ * flush of the compressor, so that a file truncated by a crash can still
+ * be decompressed up to the last complete block.
+ * Blocks of fixed size rows of doubles may be transformed before they are
+ * compressed, see RowTransform.
+ * Copyright QTronic GmbH. All rights reserved.
+ * -------------------------------------------------------------------------*/
+
+#ifndef RESULT_STREAM_H
+#define RESULT_STREAM_H
+
+#include <stddef.h>
+
+// size of a block in bytes, before compression
+#define RESULT_BLOCK_SIZE (1 << 20)
+
+// pre-transform applied to a block of rows of doubles, before compression
+typedef enum {
+    transformNone,
+    transformXor,         // each double is replaced by its bits xor the bits of the same column in the previous row
+    transformShuffle,     // bytes are grouped by column and byte position, i.e. byte planes
+    transformXorShuffle   // transformXor followed by transformShuffle
+} RowTransform;
+
+typedef struct ResultStream ResultStream;
+
+// Returns NULL to indicate failure, e.g. if the file cannot be opened.
+// level is 0 for no compression, 1 (fastest) .. 9 (best) for gzip compression.
+ResultStream *resultStreamOpen(const char *path, int level);
+// Returns 1 if gzip compression is supported by this build, 0 otherwise.
+int resultStreamCanCompress();
+// write n bytes
+void resultStreamWrite(ResultStream *rs, const void *data, size_t n);
+// write formatted text, like fprintf
+void resultStreamPrintf(ResultStream *rs, const char *format, ...);
+// From now on, only rows of nDoubles doubles are written using resultStreamWriteRow.
+// Each block written to the file starts with the number of rows in the block as
+// unsigned int, followed by the rows, transformed as given. The first row of
+// each block is xor'ed with zeros, so that blocks can be decoded independently.
+void resultStreamBeginRows(ResultStream *rs, int nDoubles, RowTransform transform);
+void resultStreamWriteRow(ResultStream *rs, const double *row);
+// flush all pending data and close the file. Returns 0 to indicate failure.
+int resultStreamClose(ResultStream *rs);
+
+#endif // RESULT_STREAM_H
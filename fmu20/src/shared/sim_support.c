@@ -19,6 +19,7 @@
 #include <string.h>
 #include <assert.h>
 #include <stdarg.h>
+#include <ctype.h>
 #include "fmi2.h"
 #include "sim_support.h"
 
@@ -362,7 +363,49 @@ static void printModelDescription(ModelDescription* md){
     free((void *)attributes);
 }
 
-void loadFMU(const char* fmuFileName) {
+// type char used in log messages for the given base type, 0 if there is none
+static char typeChar(Elm type) {
+    switch (type) {
+        case elm_Real:    return 'r';
+        case elm_Integer: return 'i';
+        case elm_Boolean: return 'b';
+        case elm_String:  return 's';
+        default:          return 0;
+    }
+}
+
+// write the names of the variables to the binary log, for the references like #r12#.
+// Of several variables with the same type and value reference, the one found by getVrName is written.
+static void logVariableNames(ModelDescription* md) {
+    int n = getScalarVariableSize(md);
+    int i;
+    for (i = 0; i < n; i++) {
+        ScalarVariable* sv = getScalarVariable(md, i);
+        Elm type = getElementType(getTypeSpec(sv));
+        fmi2ValueReference vr = getValueReference(sv);
+        if (!typeChar(type) || getVariableByValueReference(md, type, vr) != sv) continue;
+        binaryLogVariable(typeChar(type), vr, getAttributeValue((Element *)sv, att_name));
+    }
+}
+
+// name of the variable of the given type, one of ribs, and value reference.
+// Returns NULL if not found.
+static const char* getVrName(char type, fmi2ValueReference vr) {
+    ScalarVariable* sv;
+    Elm elm;
+    switch (type) {
+        case 'r': elm = elm_Real; break;
+        case 'i': elm = elm_Integer; break;
+        case 'b': elm = elm_Boolean; break;
+        case 's': elm = elm_String; break;
+        default: return NULL;
+    }
+    if (!fmu.modelDescription) return NULL;
+    sv = getVariableByValueReference(fmu.modelDescription, elm, vr);
+    return sv ? getAttributeValue((Element *)sv, att_name) : NULL;
+}
+
+void loadFMU(const char* fmuFileName, const Options *options) {
     char* fmuPath;
     char* tmpPath;
     char* xmlPath;
@@ -380,10 +423,17 @@ void loadFMU(const char* fmuFileName) {
     // parse tmpPath\modelDescription.xml
     xmlPath = calloc(sizeof(char), strlen(tmpPath) + strlen(XML_FILE) + 1);
     sprintf(xmlPath, "%s%s", tmpPath, XML_FILE);
-    fmu.modelDescription = parse(xmlPath);
+    if (options->xmlCache) {
+        int loaded;
+        fmu.modelDescription = parseCached(xmlPath, options->xmlCache, options->xmlReader, &loaded);
+        if (loaded) printf("Model description loaded from cache '%s'\n", options->xmlCache);
+    } else {
+        fmu.modelDescription = parseWithReader(xmlPath, options->xmlReader);
+    }
     free(xmlPath);
     if (!fmu.modelDescription) exit(EXIT_FAILURE);
     printModelDescription(fmu.modelDescription);
+    if (binaryLogIsOpen()) logVariableNames(fmu.modelDescription);
 #ifdef FMI_COSIMULATION
     modelId = getAttributeValue((Element *)getCoSimulation(fmu.modelDescription), att_modelIdentifier);
 #else // FMI_MODEL_EXCHANGE
@@ -419,95 +469,6 @@ void deleteUnzippedFiles() {
     free(cmd);
 }
 
-static void doubleToCommaString(char* buffer, double r){
-    char* comma;
-    sprintf(buffer, "%.16g", r);
-    comma = strchr(buffer, '.');
-    if (comma) *comma = ',';
-}
-
-// output time and all variables in CSV format
-// if separator is ',', columns are separated by ',' and '.' is used for floating-point numbers.
-// otherwise, the given separator (e.g. ';' or '\t') is to separate columns, and ',' is used 
-// as decimal dot in floating-point numbers.
-void outputRow(FMU *fmu, fmi2Component c, double time, FILE* file, char separator, fmi2Boolean header) {
-    int k;
-    fmi2Real r;
-    fmi2Integer i;
-    fmi2Boolean b;
-    fmi2String s;
-    fmi2ValueReference vr;
-    int n = getScalarVariableSize(fmu->modelDescription);
-    char buffer[32];
-
-    // print first column
-    if (header) {
-        fprintf(file, "time");
-    } else {
-        if (separator==',')
-            fprintf(file, "%.16g", time);
-        else {
-            // separator is e.g. ';' or '\t'
-            doubleToCommaString(buffer, time);
-            fprintf(file, "%s", buffer);
-        }
-    }
-
-    // print all other columns
-    for (k = 0; k < n; k++) {
-        ScalarVariable *sv = getScalarVariable(fmu->modelDescription, k);
-        if (header) {
-            // output names only
-            if (separator == ',') {
-                // treat array element, e.g. print a[1, 2] as a[1.2]
-                const char *s = getAttributeValue((Element *)sv, att_name);
-                fprintf(file, "%c", separator);
-                while (*s) {
-                    if (*s != ' ') {
-                        fprintf(file, "%c", *s == ',' ? '.' : *s);
-                    }
-                    s++;
-                }
-            } else {
-                fprintf(file, "%c%s", separator, getAttributeValue((Element *)sv, att_name));
-            }
-        } else {
-            // output values
-            vr = getValueReference(sv);
-            switch (getElementType(getTypeSpec(sv))) {
-                case elm_Real:
-                    fmu->getReal(c, &vr, 1, &r);
-                    if (separator == ',') {
-                        fprintf(file, ",%.16g", r);
-                    } else {
-                        // separator is e.g. ';' or '\t'
-                        doubleToCommaString(buffer, r);
-                        fprintf(file, "%c%s", separator, buffer);
-                    }
-                    break;
-                case elm_Integer:
-                case elm_Enumeration:
-                    fmu->getInteger(c, &vr, 1, &i);
-                    fprintf(file, "%c%d", separator, i);
-                    break;
-                case elm_Boolean:
-                    fmu->getBoolean(c, &vr, 1, &b);
-                    fprintf(file, "%c%d", separator, b);
-                    break;
-                case elm_String:
-                    fmu->getString(c, &vr, 1, &s);
-                    fprintf(file, "%c%s", separator, s);
-                    break;
-                default:
-                    fprintf(file, "%cNoValueForType=%d", separator, getElementType(getTypeSpec(sv)));
-            }
-        }
-    } // for
-
-    // terminate this row
-    fprintf(file, "\n");
-}
-
 static const char* fmi2StatusToString(fmi2Status status){
     switch (status){
         case fmi2OK:      return "ok";
@@ -522,37 +483,14 @@ static const char* fmi2StatusToString(fmi2Status status){
     }
 }
 
-// search a fmu for the given variable, matching the type specified.
-// return NULL if not found
-static ScalarVariable* getSV(FMU* fmu, char type, fmi2ValueReference vr) {
-    int i;
-    int n = getScalarVariableSize(fmu->modelDescription);
-    Elm tp;
-
-    switch (type) {
-        case 'r': tp = elm_Real;    break;
-        case 'i': tp = elm_Integer; break;
-        case 'b': tp = elm_Boolean; break;
-        case 's': tp = elm_String;  break;
-        default : tp = elm_BAD_DEFINED;
-    }
-    for (i = 0; i < n; i++) {
-        ScalarVariable* sv = getScalarVariable(fmu->modelDescription ,i);
-        if (vr == getValueReference(sv) && tp == getElementType(getTypeSpec(sv))) {
-            return sv;
-        }
-    }
-    return NULL;
-}
-
 // replace e.g. #r1365# by variable name and ## by # in message
 // copies the result to buffer
-static void replaceRefsInMessage(const char* msg, char* buffer, int nBuffer, FMU* fmu){
+static void replaceRefsInMessage(const char* msg, char* buffer, int nBuffer){
     int i = 0; // position in msg
     int k = 0; // position in buffer
     int n;
     char c = msg[i];
-    while (c != '\0' && k < nBuffer) {
+    while (c != '\0' && k < nBuffer - 1) {
         if (c != '#') {
             buffer[k++] = c;
             i++;
@@ -578,10 +516,9 @@ static void replaceRefsInMessage(const char* msg, char* buffer, int nBuffer, FMU
                 int nvr = sscanf(msg + i + 2, "%u", &vr);
                 if (nvr == 1) {
                     // vr of type detected, e.g. #r12#
-                    ScalarVariable* sv = getSV(fmu, type, vr);
-                    const char* name = sv ? getAttributeValue((Element *)sv, att_name) : "?";
-                    sprintf(buffer + k, "%s", name);
-                    k += strlen(name);
+                    const char* name = getVrName(type, vr);
+                    if (!name) name = "?";
+                    while (*name && k < nBuffer - 1) buffer[k++] = *name++;
                     i += (n+1);
                     c = msg[i];
 
@@ -598,26 +535,97 @@ static void replaceRefsInMessage(const char* msg, char* buffer, int nBuffer, FMU
 }
 
 #define MAX_MSG_SIZE 1000
-void fmuLogger(void *componentEnvironment, fmi2String instanceName, fmi2Status status,
-               fmi2String category, fmi2String message, ...) {
-    char msg[MAX_MSG_SIZE];
-    char* copy;
-    va_list argp;
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+// print a log message, replacing e.g. ## and #r12#
+static void printLogMessage(int status, const char *instanceName, const char *category, const char *formatted) {
+    // scratch buffer per thread, as the FMU may log from several threads
+    static THREAD_LOCAL char msg[MAX_MSG_SIZE];
+    replaceRefsInMessage(formatted, msg, MAX_MSG_SIZE);
+    printf("%s %s (%s): %s\n", fmi2StatusToString(status), instanceName, category, msg);
+}
+
+// called by the background thread of the log queue
+static void writeLogRecord(const LogRecord *record) {
+    printLogMessage(record->status, record->instanceName, record->category, record->message);
+}
+
+static void reportDroppedLogRecords(unsigned long n) {
+    printf("%lu log messages dropped because the log queue was full\n", n);
+}
+
+static void copyLogName(char *buffer, const char *name) {
+    strncpy(buffer, name, LOG_NAME_SIZE - 1);
+    buffer[LOG_NAME_SIZE - 1] = '\0';
+}
+
+// log a message, formatted now or later, see options -a and -b
+static void logMessage(int status, const char *instanceName, const char *category, const char *message,
+        va_list argp) {
+    static THREAD_LOCAL char formatted[MAX_MSG_SIZE];
+
+    if (binaryLogIsOpen()) {
+        // store the raw arguments, formatted later by fmusim_log
+        binaryLogMessage(status, instanceName, category, message, argp);
+        return;
+    }
+
+    if (logQueueEnter()) {
+        // format into a slot of the queue, the background thread does the rest
+        LogRecord *record = logQueueAcquire();
+        if (record) { // else dropped
+            record->status = status;
+            copyLogName(record->instanceName, instanceName);
+            copyLogName(record->category, category);
+            vsnprintf(record->message, LOG_MESSAGE_SIZE, message, argp);
+            logQueueCommit(record);
+        }
+        logQueueLeave();
+        return;
+    }
 
     // replace C format strings
+    vsnprintf(formatted, MAX_MSG_SIZE, message, argp);
+    printLogMessage(status, instanceName, category, formatted);
+}
+
+static void logFormatted(int status, const char *instanceName, const char *category, const char *message, ...) {
+    va_list argp;
     va_start(argp, message);
-    vsprintf(msg, message, argp);
+    logMessage(status, instanceName, category, message, argp);
     va_end(argp);
+}
+
+static void reportSuppressedMessages(const char *instanceName, const char *category, unsigned long n) {
+    logFormatted(fmi2Warning, instanceName, category, "%lu messages suppressed by the rate limit", n);
+}
 
-    // replace e.g. ## and #r12#
-    copy = strdup(msg);
-    replaceRefsInMessage(copy, msg, MAX_MSG_SIZE, &fmu);
-    free(copy);
+static void flushSuppressedMessages() {
+    logFilterFlush(reportSuppressedMessages);
+}
+
+void fmuLogger(void *componentEnvironment, fmi2String instanceName, fmi2Status status,
+               fmi2String category, fmi2String message, ...) {
+    va_list argp;
 
-    // print the final message
     if (!instanceName) instanceName = "?";
     if (!category) category = "?";
-    printf("%s %s (%s): %s\n", fmi2StatusToString(status), instanceName, category, msg);
+
+    if (logFilterIsActive()) {
+        unsigned long nSuppressed;
+        int accept = logFilterAccept(instanceName, category, &nSuppressed);
+        if (nSuppressed > 0) reportSuppressedMessages(instanceName, category, nSuppressed);
+        if (!accept) return;
+    }
+
+    va_start(argp, message);
+    logMessage(status, instanceName, category, message, argp);
+    va_end(argp);
 }
 
 int error(const char* message){
@@ -625,9 +633,192 @@ int error(const char* message){
     return 0;
 }
 
+// Parse the options, e.g. -e changes, and remove them from argv,
+// so that the remaining arguments can be parsed by position.
+// An option starts with '-' followed by a letter, other than a negative number.
+// Returns the number of remaining arguments.
+static int parseOptions(int argc, char *argv[], Options *options) {
+    int i;
+    int n = 1; // number of remaining arguments, argv[0] is kept
+    options->output.encoding = encodingRows;
+    options->output.deadband = 0;
+    options->output.compression = 0;
+    options->output.transform = transformNone;
+    options->output.telemetry = NULL;
+    options->output.nSinks = 0;
+    options->output.nSummaryVariables = 0;
+    options->asyncLog = 0;
+    options->logOverflow = overflowBlock;
+    options->binaryLog = NULL;
+    options->xmlReader = readerLibxml2;
+    options->xmlCache = NULL;
+    options->output.summaryVariables = (const char **)calloc(argc, sizeof(char *));
+    if (!options->output.summaryVariables) {
+        printf("error: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    for (i = 1; i < argc; i++) {
+        const char *value;
+        if (argv[i][0] != '-' || !isalpha((unsigned char)argv[i][1]) || argv[i][2] != '\0') {
+            argv[n++] = argv[i];
+            continue;
+        }
+        if (i + 1 == argc) {
+            printf("error: Missing value of option %s\n", argv[i]);
+            printHelp(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+        value = argv[++i];
+        switch (argv[i - 1][1]) {
+            case 'e':
+                if (!strcmp(value, "rows")) options->output.encoding = encodingRows;
+                else if (!strcmp(value, "changes")) options->output.encoding = encodingChanges;
+                else if (!strcmp(value, "binary")) options->output.encoding = encodingBinary;
+                else {
+                    printf("error: The given encoding (%s) is not one of rows, changes, binary\n", value);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'd':
+                if (sscanf(value, "%lf", &options->output.deadband) != 1 || options->output.deadband < 0) {
+                    printf("error: The given deadband (%s) is not a non-negative number\n", value);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'z':
+                if (sscanf(value, "%d", &options->output.compression) != 1
+                        || options->output.compression < 0 || options->output.compression > 9) {
+                    printf("error: The given compression level (%s) is not in 0..9\n", value);
+                    exit(EXIT_FAILURE);
+                }
+                if (options->output.compression > 0 && !resultStreamCanCompress()) {
+                    printf("error: Compression of the result file is not supported by this build\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 't':
+                if (!strcmp(value, "none")) options->output.transform = transformNone;
+                else if (!strcmp(value, "xor")) options->output.transform = transformXor;
+                else if (!strcmp(value, "shuffle")) options->output.transform = transformShuffle;
+                else if (!strcmp(value, "xorshuffle")) options->output.transform = transformXorShuffle;
+                else {
+                    printf("error: The given transform (%s) is not one of none, xor, shuffle, xorshuffle\n", value);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'a':
+                if (!strcmp(value, "block")) options->logOverflow = overflowBlock;
+                else if (!strcmp(value, "drop")) options->logOverflow = overflowDrop;
+                else if (!strcmp(value, "count")) options->logOverflow = overflowCount;
+                else {
+                    printf("error: The given overflow policy (%s) is not one of block, drop, count\n", value);
+                    exit(EXIT_FAILURE);
+                }
+                if (!logQueueIsSupported()) {
+                    printf("error: Asynchronous logging is not supported on this platform\n");
+                    exit(EXIT_FAILURE);
+                }
+                options->asyncLog = 1;
+                break;
+            case 'b':
+                options->binaryLog = value;
+                break;
+            case 'c':
+                options->xmlCache = value;
+                break;
+            case 'x':
+                if (!strcmp(value, "libxml2")) options->xmlReader = readerLibxml2;
+                else if (!strcmp(value, "tokenizer")) options->xmlReader = readerTokenizer;
+                else if (!strcmp(value, "parallel")) options->xmlReader = readerParallel;
+                else if (!strcmp(value, "lazy")) options->xmlReader = readerLazy;
+                else {
+                    printf("error: The given xml reader (%s) is not one of libxml2, tokenizer, parallel, lazy\n", value);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'f':
+                if (!logFilterAddRule(value)) {
+                    printf("error: The given filter (%s) is not of the form [-][<instance>:]<category>\n", value);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'r': {
+                double rate;
+                double burst;
+                int nValues = sscanf(value, "%lf:%lf", &rate, &burst);
+                if (nValues == 1) burst = rate < 1 ? 1 : rate;
+                if (nValues < 1 || !logFilterSetRate(rate, burst)) {
+                    printf("error: The given rate limit (%s) is not of the form <rate>[:<burst>] "
+                            "with rate > 0 and burst >= 1\n", value);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'o':
+                if (!isOutputSink(value)) {
+                    printf("error: The given sink (%s) is not one of csv, changes, binary, shm, summary\n", value);
+                    exit(EXIT_FAILURE);
+                }
+                if (options->output.nSinks == MAX_OUTPUT_SINKS) {
+                    printf("error: More than %d sinks given\n", MAX_OUTPUT_SINKS);
+                    exit(EXIT_FAILURE);
+                }
+                options->output.sinks[options->output.nSinks++] = value;
+                break;
+            case 's':
+                options->output.summaryVariables[options->output.nSummaryVariables++] = value;
+                break;
+            case 'm':
+                if (!telemetryIsSupported()) {
+                    printf("error: Shared memory telemetry is not supported on this platform\n");
+                    exit(EXIT_FAILURE);
+                }
+                if (value[0] != '/' || strchr(value + 1, '/')) {
+                    printf("error: The given shared memory name (%s) is not of the form /name\n", value);
+                    exit(EXIT_FAILURE);
+                }
+                options->output.telemetry = value;
+                break;
+            default:
+                printf("error: Unknown option %s\n", argv[i - 1]);
+                printHelp(argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (options->output.transform != transformNone && options->output.encoding != encodingBinary
+            && options->output.nSinks == 0) {
+        printf("error: Option -t requires the binary encoding\n");
+        exit(EXIT_FAILURE);
+    }
+    if (options->asyncLog && options->binaryLog) {
+        printf("error: Options -a and -b cannot be combined\n");
+        exit(EXIT_FAILURE);
+    }
+    argv[n] = NULL;
+    return n;
+}
+
 void parseArguments(int argc, char *argv[], const char **fmuFileName, double *tEnd, double *h,
-        int *loggingOn, char *csv_separator, int *nCategories, /*const*/ fmi2String *logCategories[]) {
+        int *loggingOn, char *csv_separator, int *nCategories, /*const*/ fmi2String *logCategories[],
+        Options *options) {
     // parse command line arguments
+    argc = parseOptions(argc, argv, options);
+    if (options->asyncLog) {
+        if (!logQueueStart(options->logOverflow, writeLogRecord, reportDroppedLogRecords)) {
+            printf("error: Could not start the background thread for logging\n");
+            exit(EXIT_FAILURE);
+        }
+        // write the pending messages also when exiting on an error
+        atexit(logQueueStop);
+    }
+    if (options->binaryLog) {
+        if (!binaryLogOpen(options->binaryLog)) exit(EXIT_FAILURE);
+        atexit(binaryLogClose);
+    }
+    if (logFilterIsActive()) {
+        // registered last to report before the log queue is stopped and the binary log is closed
+        atexit(flushSuppressedMessages);
+    }
     if (argc > 1) {
         *fmuFileName = argv[1];
     } else {
@@ -675,11 +866,44 @@ void parseArguments(int argc, char *argv[], const char **fmuFileName, double *tE
 }
 
 void printHelp(const char *fmusim) {
-    printf("command syntax: %s <model.fmu> <tEnd> <h> <loggingOn> <csv separator>\n", fmusim);
+    printf("command syntax: %s [options] <model.fmu> <tEnd> <h> <loggingOn> <csv separator>\n", fmusim);
     printf("   <model.fmu> .... path to FMU, relative to current dir or absolute, required\n");
     printf("   <tEnd> ......... end  time of simulation,   optional, defaults to 1.0 sec\n");
     printf("   <h> ............ step size of simulation,   optional, defaults to 0.1 sec\n");
     printf("   <loggingOn> .... 1 to activate logging,     optional, defaults to 0\n");
     printf("   <csv separator>. separator in csv file,     optional, c for ',', s for';', defaults to c\n");
     printf("   <logCategories>. list of active categories, optional, see modelDescription.xml for possible values\n");
+    printf("options:\n");
+    printf("   -e <encoding> .. rows: all variables at each step, changes: time,name,value of changed variables,\n");
+    printf("                    binary: doubles of all but String variables, optional, defaults to rows\n");
+    printf("   -d <deadband> .. changes encoding: write Reals only if changed by more, optional, defaults to 0\n");
+    printf("   -z <level> ..... gzip compression level 1..9 of the result file, optional, defaults to 0 (none)\n");
+    printf("   -t <transform> . binary encoding: none, xor, shuffle or xorshuffle applied to blocks of rows,\n");
+    printf("                    optional, defaults to none\n");
+    printf("   -m </name> ..... write each output step also to the POSIX shared memory segment /name,\n");
+    printf("                    see shared/telemetry.h, optional\n");
+    printf("   -o <sink> ...... write the output to the given sink instead of the result file of -e, may be\n");
+    printf("                    repeated: csv[:<file>], changes[:<file>], binary[:<file>], shm:</name> or\n");
+    printf("                    summary[:<file>] for final value, min, max, integral, mean and RMS,\n");
+    printf("                    a given file name is used as is, the encoding options apply to the sink\n");
+    printf("                    of the same name, optional\n");
+    printf("   -s <variable> .. summary sink: variable to reduce, may be repeated, optional, defaults to all\n");
+    printf("                    but String variables\n");
+    printf("   -a <overflow> .. log asynchronously from a background thread; if its queue is full, block\n");
+    printf("                    the logging thread, drop the message, or count: drop and report the number,\n");
+    printf("                    optional, defaults to synchronous logging\n");
+    printf("   -b <file> ...... write the log messages unformatted to the given binary file, to be rendered\n");
+    printf("                    as text by fmusim_log, optional\n");
+    printf("   -f <filter> .... log only the messages of [<instance>:]<category>, or all but these if prefixed\n");
+    printf("                    with -, * matches any, may be repeated, the last matching filter decides,\n");
+    printf("                    see shared/log_filter.h, optional\n");
+    printf("   -r <rate> ...... log at most <rate>[:<burst>] messages per second per instance and category\n");
+    printf("                    and report the number of suppressed messages, optional\n");
+    printf("   -x <reader> .... reader of modelDescription.xml: libxml2, or tokenizer for a faster reader\n");
+    printf("                    of UTF-8 or ISO-8859-1 files without DOCTYPE, or parallel: the tokenizer,\n");
+    printf("                    building the variables of a large model on all processors, or lazy: the\n");
+    printf("                    tokenizer, parsing variables, units, annotations and model structure on\n");
+    printf("                    first access, optional, defaults to libxml2\n");
+    printf("   -c <file> ...... cache the parsed modelDescription.xml in the given file and load it from\n");
+    printf("                    there instead of parsing while the xml file is unchanged, optional\n");
 }
@@ -15,8 +15,12 @@
 // -d   The directory in which to write files.
 #define UNZIP_CMD "unzip -o -d "
 #endif
+#include "output.h"
+#include "log_queue.h"
+#include "binary_log.h"
+#include "log_filter.h"
+
 #define XML_FILE  "modelDescription.xml"
-#define RESULT_FILE "result.csv"
 #define BUFSIZE 4096
 #if WINDOWS
 #ifdef _WIN64
@@ -67,13 +71,23 @@
 #define SEVEN_ZIP_OUT_OF_MEMORY 8
 #define SEVEN_ZIP_STOPPED_BY_USER 255
 
+// options given as -<letter> <value> anywhere on the command line
+typedef struct {
+    OutputOptions output;     // options of the output of the simulation results
+    int asyncLog;             // 1 to log from a background thread, see log_queue.h
+    LogOverflow logOverflow;  // asyncLog: what to do if the log queue is full
+    const char *binaryLog;    // file for the log messages in binary form, see binary_log.h, or NULL
+    XmlReader xmlReader;      // reader of modelDescription.xml
+    const char *xmlCache;     // file to cache the parsed modelDescription.xml in, see XmlCache.h, or NULL
+} Options;
+
 void fmuLogger(fmi2Component c, fmi2String instanceName, fmi2Status status, fmi2String category, fmi2String message, ...);
 int unzip(const char *zipPath, const char *outPath);
 void parseArguments(int argc, char *argv[], const char **fmuFileName, double *tEnd, double *h,
-        int *loggingOn, char *csv_separator, int *nCategories, /*const*/ fmi2String *logCategories[]);
-void loadFMU(const char *fmuFileName);
+        int *loggingOn, char *csv_separator, int *nCategories, /*const*/ fmi2String *logCategories[],
+        Options *options);
+void loadFMU(const char *fmuFileName, const Options *options);
 void deleteUnzippedFiles();
-void outputRow(FMU *fmu, fmi2Component c, double time, FILE* file, char separator, fmi2Boolean header);
 int error(const char *message);
 void printHelp(const char *fmusim);
 char *getTempResourcesLocation(); // caller has to free the result
@@ -0,0 +1,217 @@
+/* -------------------------------------------------------------------------
+ * telemetry.c
+ * Live telemetry of a running simulation in a POSIX shared memory segment,
+ * see telemetry.h for the layout of the segment and the ring protocol.
+ * Copyright QTronic GmbH. All rights reserved.
+ * -------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "telemetry.h"
+
+#ifdef _MSC_VER
+
+int telemetryIsSupported() {
+    return 0;
+}
+
+Telemetry *telemetryOpen(const char *name, int nColumns, const char *types, const char **names,
+        unsigned int capacity) {
+    printf("error: Shared memory telemetry is not supported on this platform\n");
+    return NULL;
+}
+
+void telemetryWriteRow(Telemetry *t, const double *row) {
+}
+
+void telemetryCountEvent(Telemetry *t) {
+}
+
+void telemetryClose(Telemetry *t) {
+}
+
+const TelemetryHeader *telemetryAttach(const char *name) {
+    return NULL;
+}
+
+void telemetryDetach(const TelemetryHeader *h) {
+}
+
+unsigned long long telemetryRowCount(const TelemetryHeader *h) {
+    return 0;
+}
+
+const char *telemetryColumnName(const TelemetryHeader *h, int k, char *type) {
+    return NULL;
+}
+
+int telemetryReadRow(const TelemetryHeader *h, unsigned long long i, double *row) {
+    return 0;
+}
+
+#else
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// alignment of the ring, to keep rows off the cache line of the header
+#define ROWS_ALIGNMENT 64
+
+struct Telemetry {
+    char *name;                // name of the segment, for shm_unlink
+    TelemetryHeader *header;   // start of the mapped segment
+    double *rows;              // the ring
+    size_t size;               // size of the segment in bytes
+    size_t rowSize;            // bytes per row
+    unsigned long long count;  // private copy of header->count
+};
+
+static size_t segmentSize(const TelemetryHeader *h) {
+    return h->rowsOffset + (size_t)h->capacity * h->nColumns * sizeof(double);
+}
+
+int telemetryIsSupported() {
+    return 1;
+}
+
+Telemetry *telemetryOpen(const char *name, int nColumns, const char *types, const char **names,
+        unsigned int capacity) {
+    Telemetry *t;
+    TelemetryHeader header;
+    char *columns;
+    size_t columnsSize = 0;
+    int k;
+    int fd;
+    void *p;
+
+    for (k = 0; k < nColumns; k++) columnsSize += 1 + strlen(names[k]) + 1;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TELEMETRY_MAGIC, sizeof(header.magic));
+    header.version = TELEMETRY_VERSION;
+    header.nColumns = nColumns;
+    header.capacity = capacity > 0 ? capacity : TELEMETRY_ROWS;
+    header.columnsOffset = sizeof(TelemetryHeader);
+    header.rowsOffset = (header.columnsOffset + columnsSize + ROWS_ALIGNMENT - 1) / ROWS_ALIGNMENT
+            * ROWS_ALIGNMENT;
+    header.state = telemetryRunning;
+
+    t = (Telemetry *)calloc(1, sizeof(Telemetry));
+    if (!t) return NULL;
+    t->name = strdup(name);
+    t->size = segmentSize(&header);
+    t->rowSize = nColumns * sizeof(double);
+    if (!t->name) {
+        free(t);
+        return NULL;
+    }
+
+    shm_unlink(name); // readers of a previous run keep their mapping
+    fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        printf("error: Could not create shared memory %s: %s\n", name, strerror(errno));
+        free(t->name);
+        free(t);
+        return NULL;
+    }
+    if (ftruncate(fd, t->size) != 0) {
+        printf("error: Could not resize shared memory %s: %s\n", name, strerror(errno));
+        close(fd);
+        shm_unlink(name);
+        free(t->name);
+        free(t);
+        return NULL;
+    }
+    p = mmap(NULL, t->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        printf("error: Could not map shared memory %s: %s\n", name, strerror(errno));
+        shm_unlink(name);
+        free(t->name);
+        free(t);
+        return NULL;
+    }
+
+    t->header = (TelemetryHeader *)p;
+    t->rows = (double *)((char *)p + header.rowsOffset);
+    columns = (char *)p + header.columnsOffset;
+    for (k = 0; k < nColumns; k++) {
+        *columns++ = types[k];
+        strcpy(columns, names[k]);
+        columns += strlen(names[k]) + 1;
+    }
+    *t->header = header;
+    return t;
+}
+
+void telemetryWriteRow(Telemetry *t, const double *row) {
+    unsigned int slot = (unsigned int)(t->count % t->header->capacity);
+    t->count++;
+    // head must be visible before the slot is modified, readers check it after copying a row
+    __atomic_store_n(&t->header->head, t->count, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(t->rows + (size_t)slot * t->header->nColumns, row, t->rowSize);
+    // publish the row, readers load count with acquire semantics
+    __atomic_store_n(&t->header->count, t->count, __ATOMIC_RELEASE);
+}
+
+void telemetryCountEvent(Telemetry *t) {
+    __atomic_store_n(&t->header->events, t->header->events + 1, __ATOMIC_RELAXED);
+}
+
+void telemetryClose(Telemetry *t) {
+    __atomic_store_n(&t->header->state, telemetryFinished, __ATOMIC_RELEASE);
+    munmap(t->header, t->size);
+    shm_unlink(t->name);
+    free(t->name);
+    free(t);
+}
+
+const TelemetryHeader *telemetryAttach(const char *name) {
+    TelemetryHeader header;
+    void *p;
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) return NULL;
+    if (read(fd, &header, sizeof(header)) != sizeof(header)
+            || memcmp(header.magic, TELEMETRY_MAGIC, sizeof(header.magic))
+            || header.version != TELEMETRY_VERSION) {
+        close(fd);
+        return NULL;
+    }
+    p = mmap(NULL, segmentSize(&header), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    return p == MAP_FAILED ? NULL : (const TelemetryHeader *)p;
+}
+
+void telemetryDetach(const TelemetryHeader *h) {
+    munmap((void *)h, segmentSize(h));
+}
+
+unsigned long long telemetryRowCount(const TelemetryHeader *h) {
+    return __atomic_load_n(&h->count, __ATOMIC_ACQUIRE);
+}
+
+const char *telemetryColumnName(const TelemetryHeader *h, int k, char *type) {
+    const char *columns = (const char *)h + h->columnsOffset;
+    if (k < 0 || k >= (int)h->nColumns) return NULL;
+    while (k-- > 0) columns += 1 + strlen(columns + 1) + 1;
+    if (type) *type = columns[0];
+    return columns + 1;
+}
+
+int telemetryReadRow(const TelemetryHeader *h, unsigned long long i, double *row) {
+    const double *rows = (const double *)((const char *)h + h->rowsOffset);
+    unsigned long long count = telemetryRowCount(h);
+    unsigned long long head;
+    if (i >= count || count - i > h->capacity) return 0;
+    memcpy(row, rows + (size_t)(i % h->capacity) * h->nColumns, h->nColumns * sizeof(double));
+    // the copy must be complete before head is loaded
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    head = __atomic_load_n(&h->head, __ATOMIC_RELAXED);
+    return head - i <= h->capacity;
+}
+
+#endif // _MSC_VER
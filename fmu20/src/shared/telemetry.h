@@ -0,0 +1,82 @@
+/* -------------------------------------------------------------------------
+ * telemetry.h
+ * Live telemetry of a running simulation in a POSIX shared memory segment.
+ * fmusim_me and fmusim_cs write one row of doubles per output step into a
+ * ring in the segment, any number of local processes may map the segment
+ * read-only and watch the rows while the simulation runs.
+ *
+ * Layout of the segment, all numbers in the byte order of the host:
+ *   TelemetryHeader
+ *   nColumns column descriptions, each a type char (one of r, i, b)
+ *       followed by the '\0' terminated name. Column 0 is the time.
+ *   ring of capacity rows of nColumns doubles, at rowsOffset
+ *
+ * The ring has a single producer and uses no locks. Row i is stored in
+ * slot i % capacity. Before the producer writes row i into its slot, it
+ * stores head = i + 1, followed by a release fence. After writing the row,
+ * it publishes the row by storing count = i + 1 with release semantics.
+ * A reader loads count with acquire semantics, copies a row i < count,
+ * issues an acquire fence and loads head: the copy is valid if head is at
+ * most i + capacity, i.e. the producer has not started to overwrite the
+ * slot. This is done by telemetryReadRow.
+ *
+ * The segment is removed when the simulation ends. Readers that have the
+ * segment mapped keep the final rows and see state telemetryFinished.
+ * Shared memory is not supported on Windows.
+ * Copyright QTronic GmbH. All rights reserved.
+ * -------------------------------------------------------------------------*/
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#define TELEMETRY_MAGIC "FMUSIMTM"
+#define TELEMETRY_VERSION 1
+// default number of rows in the ring
+#define TELEMETRY_ROWS 4096
+
+typedef enum {
+    telemetryRunning,
+    telemetryFinished
+} TelemetryState;
+
+typedef struct {
+    char magic[8];                  // TELEMETRY_MAGIC, not terminated
+    unsigned int version;           // TELEMETRY_VERSION
+    unsigned int nColumns;          // doubles per row, time followed by the variables
+    unsigned int capacity;          // number of rows in the ring
+    unsigned int columnsOffset;     // offset of the column descriptions from the start of the segment
+    unsigned int rowsOffset;        // offset of the ring from the start of the segment
+    unsigned int state;             // a TelemetryState, updated with release semantics
+    unsigned int events;            // number of events handled so far
+    unsigned long long head;        // number of rows the producer started to write
+    unsigned long long count;       // number of rows written so far, updated with release semantics
+} TelemetryHeader;
+
+typedef struct Telemetry Telemetry;
+
+// Returns 1 if shared memory telemetry is supported by this build, 0 otherwise.
+int telemetryIsSupported();
+
+// Producer: create the segment with the given name, e.g. "/fmusim", replacing an
+// existing one. types and names describe the nColumns columns.
+// Returns NULL to indicate failure.
+Telemetry *telemetryOpen(const char *name, int nColumns, const char *types, const char **names,
+        unsigned int capacity);
+// append a row of nColumns doubles to the ring
+void telemetryWriteRow(Telemetry *t, const double *row);
+// increment the number of events
+void telemetryCountEvent(Telemetry *t);
+// mark the segment finished and remove it
+void telemetryClose(Telemetry *t);
+
+// Reader: map the segment with the given name read-only. Returns NULL to indicate failure.
+const TelemetryHeader *telemetryAttach(const char *name);
+void telemetryDetach(const TelemetryHeader *h);
+// number of rows written so far
+unsigned long long telemetryRowCount(const TelemetryHeader *h);
+// name and type of column k, in 0..nColumns-1
+const char *telemetryColumnName(const TelemetryHeader *h, int k, char *type);
+// copy row i to row. Returns 0 if row i has not been written yet or has been overwritten.
+int telemetryReadRow(const TelemetryHeader *h, unsigned long long i, double *row);
+
+#endif // TELEMETRY_H